@@ -1,69 +1,503 @@
 #include "provided.h"
+#include "MyHash.h"
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <utility>
+#include <cctype>
+#include <cmath>
+#include <memory>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
 using namespace std;
 
+// Relative frequencies (in percent) of the letters a-z in ordinary English text
+const double ENGLISH_LETTER_FREQ[26] = {
+	8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094, 6.966, 0.153, 0.772, 4.025, 2.406,
+	6.749, 7.507, 1.929, 0.095, 5.987, 6.327, 9.056, 2.758, 0.978, 2.360, 0.150, 1.974, 0.074
+};
+
+// Messages at least this long are cracked by solving a sample of their words first
+const unsigned int LONG_TEXT_LENGTH = 2048;
+// Once every letter is covered, the sample is topped up with the rarest remaining words to this size
+const unsigned int SAMPLE_WORDS = 32;
+// The candidate cache is emptied once it holds this many candidate words in total
+const int CANDIDATE_CACHE_WORDS = 1 << 18;
+// ... or once it holds this many entries, counting entries without candidates too
+const int CANDIDATE_CACHE_ENTRIES = 1 << 16;
+// At most this many entries per pattern are considered when looking for a broader entry to filter
+const unsigned int BROADER_ENTRIES_PER_PATTERN = 64;
+// Two cached keys are only merged if they agree on at least this many letters and contradict on none
+const int KEY_MERGE_MIN_OVERLAP = 8;
+// First line of a checkpoint file
+const char CHECKPOINT_HEADER[] = "decrypter checkpoint 2";
+// Appended to a checkpoint file's name to name the file its solutions are kept in
+const char SOLUTIONS_SUFFIX[] = ".solutions";
+// A resumable crack rewrites its checkpoint at least this often
+const int CHECKPOINT_SECONDS = 30;
+
 class DecrypterImpl
 {
 public:
 	DecrypterImpl();
     bool load(string filename);
+    bool load(string filename, const string& ciphertext);
+    bool load(shared_ptr<const WordList> wordList);
+    bool reload(string filename);
+    void unload();
     vector<string> crack(const string& ciphertext);
+    vector<vector<string>> crack(const vector<string>& ciphertexts);
+    bool crack(const string& ciphertext, const string& checkpointFile, vector<string>& solutions);
+    ResumeFailure resumeFailure() const;
+    void setFrequencyPriors(bool enabled);
+    void setLongTextMode(bool enabled);
+    void setTimeLimit(int milliseconds);
+    void setKeyCacheSize(int numKeys);
+    bool timedOut() const;
+    DecrypterStats getStats() const;
 private:
-	// Recursive helper function
-	void crack(const string& ciphertext, vector<string>& output);
+	bool beginCrack(const string& ciphertext);	// sets up a crack; false if there are no words or no usable word list
+	void endCrack(vector<string>& solutions);	// sorts the solutions and lets go of the word list snapshot
+
+	// Search engine; numLevels is how many entries of m_levels are already set up, 0 to start afresh.
+	// When it is done it pops the mapping its caller pushed, just as the recursive search did
+	void crack(const string& ciphertext, vector<string>& output, unsigned int numLevels);
+	bool openLevel(unsigned int depth);		// picks a word and finds its candidates; false if there are none
+
+	// Solves a small sample of the message's words, then checks each key against the whole message
+	void crackBySample(const string& ciphertext, vector<string>& output);
+
+	// Helper functions
+	void findCandidates(const string& cipherWord, const string& translatedWord, vector<const string*>& candidates);	// cached WordList::findCandidates
+	void clearCandidateCache();
+	void rankCandidates(const string& cipherWord, const string& translatedWord, vector<const string*>& candidates);
+	bool hasImpossibleBigram(const string& translatedWord) const;
+	bool outOfTime();					// true once the current crack has used up its time limit
+	bool tryCachedKeys(const string& ciphertext, vector<string>& output);	// true if a cached key fits the whole message
+	void rememberKey(const string& ciphertext, const string& plaintext);
+	bool writeCheckpoint(const string& ciphertext, const vector<string>& output, unsigned int numLevels, bool finished);
+	bool readCheckpoint(const string& checkpointFile, const string& ciphertext, vector<string>& output,
+		vector<unsigned int>& next, vector<unsigned int>& sizes, bool& finished);	// false if it is unusable for this crack
+	bool restoreLevels(const vector<unsigned int>& next, const vector<unsigned int>& sizes);
 
-	WordList wl;						// WordList object
+	shared_ptr<const WordList> m_published;	// latest WordList, possibly shared with other decrypters; only
+											// accessed through atomic_load/atomic_store so it can be replaced mid-crack
+	shared_ptr<const WordList> wl;		// snapshot of m_published that the current crack uses from start to finish
 	Translator t;						// Translator object
 	Tokenizer token;					// Tokenizer object
 	vector<string> tokenizedWords;		// vector of tokenized words
+	bool m_usePriors;					// whether candidates are ranked and pruned using letter statistics
+	bool m_useLongTextMode;				// whether long messages are cracked through a sample of their words
+	int m_cipherFreq[26];				// number of times each cipher letter occurs in the current message
+	int m_numCipherLetters;				// total number of letters in the current message
+	int m_timeLimit;					// milliseconds a crack may take, or 0 for no limit
+	chrono::steady_clock::time_point m_deadline;	// when the current crack has to stop
+	bool m_timedOut;					// whether the current crack stopped early
+	MyHash<string, vector<const string*>> m_candidateCache;	// pattern and known letters of a word -> its candidates
+	MyHash<string, vector<string>> m_cachedTranslations;		// pattern -> known letters it has cache entries for
+	int m_numCachedCandidates;			// candidate words held in m_candidateCache
+	int m_numCachedTranslations;		// known-letter strings held in m_cachedTranslations
+	DecrypterStats m_stats;				// counters reported by getStats()
+	list<string> m_keys;				// recently recovered keys, most recently used first; each maps 'a'..'z' to
+										// the plaintext letter it stands for, or '?' if it has not been seen
+	unsigned int m_keyCacheSize;		// maximum number of keys in m_keys, 0 to disable the key cache
+	Translator m_keyTranslator;			// applies one cached key at a time
+	double m_keyCacheHitMs;				// total time of cracks answered from the key cache
+	double m_keyCacheMissMs;			// total time of cracks that needed a search while the key cache was on
+	string m_checkpointFile;			// checkpoint kept up to date by the current crack, or empty for none
+	chrono::steady_clock::time_point m_lastCheckpoint;	// when the checkpoint was last written
+	unsigned int m_numSavedSolutions;	// solutions of the current crack already appended to the solutions file
+	ResumeFailure m_resumeFailure;		// why the last resumable crack could not go on
+
+	// The search's stack, reused from one crack to the next so that the search does not allocate in steady state
+	struct Level
+	{
+		int pickedWord;						// index in tokenizedWords of the word picked at this depth
+		vector<const string*> candidates;	// candidates for the picked word, pointing into the word list
+		unsigned int next;					// index in candidates of the next candidate to try
+		string translatedWord;				// translation of the picked word
+		string translatedCipher;			// translation of the whole message
+	};
+	deque<Level> m_levels;				// one entry per search depth; a deque so deeper levels never move shallower ones
+	string m_pattern;					// findCandidates: pattern of the word
+	string m_known;						// findCandidates: letters already known for the word
+	string m_cacheKey;					// findCandidates: cache key being looked up
+	vector<pair<double, int>> m_scores;	// rankCandidates: (negated score, index) of each candidate
+	vector<const string*> m_ranked;		// rankCandidates: candidates in their new order
+	string m_keyCipher;					// tryCachedKeys: cipher letters the key being tried knows
+	string m_keyPlain;					// tryCachedKeys: plaintext letters they stand for
+	string m_keyWord;					// tryCachedKeys: translation of one word of the message
 };
 
 DecrypterImpl::DecrypterImpl()
-	: token(" ,;:.!()[]{}-\"#$%^&0123456789")
+	: m_published(make_shared<WordList>()), token(" ,;:.!()[]{}-\"#$%^&0123456789"), m_usePriors(true), m_useLongTextMode(true),
+	  m_numCipherLetters(0), m_timeLimit(0), m_timedOut(false), m_numCachedCandidates(0), m_numCachedTranslations(0),
+	  m_keyCacheSize(0), m_keyCacheHitMs(0), m_keyCacheMissMs(0), m_numSavedSolutions(0), m_resumeFailure(ResumeFailure::None)
 {
+	for (int i = 0; i < 26; i++)
+		m_cipherFreq[i] = 0;
+	m_stats.candidateCacheHits = 0;
+	m_stats.candidateCacheFiltered = 0;
+	m_stats.candidateCacheMisses = 0;
+	m_stats.keyCacheHits = 0;
+	m_stats.keyCacheMisses = 0;
+	m_stats.keyCacheSavedMs = 0;
 }
 
 bool DecrypterImpl::load(string filename)
 {
-	if (!wl.loadWordList(filename))
+	return reload(filename);
+}
+
+bool DecrypterImpl::load(string filename, const string& ciphertext)
+{
+	// only index the parts of the word list this message can use
+	shared_ptr<WordList> newList = make_shared<WordList>();
+	if (!newList->loadWordList(filename, token.tokenize(ciphertext)))
 		return false;
+	atomic_store(&m_published, shared_ptr<const WordList>(newList));
 	return true;
 }
 
+bool DecrypterImpl::load(shared_ptr<const WordList> wordList)
+{
+	if (wordList == nullptr)
+		return false;
+	atomic_store(&m_published, wordList);		// share an already loaded word list instead of reading the file again
+	return true;
+}
+
+bool DecrypterImpl::reload(string filename)
+{
+	// build the new list without touching the published one, so a crack running on another thread
+	// carries on undisturbed; it sees the new list from its next call on
+	shared_ptr<WordList> newList = make_shared<WordList>();
+	if (!newList->loadWordList(filename))
+		return false;
+	atomic_store(&m_published, shared_ptr<const WordList>(newList));
+	return true;
+}
+
+void DecrypterImpl::unload()
+{
+	atomic_store(&m_published, shared_ptr<const WordList>());
+}
+
 vector<string> DecrypterImpl::crack(const string& ciphertext)
 {
 
 	vector<string> validSolutions;		// vector of valid solution strings
 
+	if (!beginCrack(ciphertext))
+		return validSolutions;				// nothing to crack
+
+	// a message encrypted with a recently recovered key only needs one pass over its words
+	chrono::steady_clock::time_point started = chrono::steady_clock::now();
+	bool keyCacheHit = (m_keyCacheSize > 0 && tryCachedKeys(ciphertext, validSolutions));
+	if (!keyCacheHit)
+	{
+		if (m_useLongTextMode && ciphertext.size() >= LONG_TEXT_LENGTH)
+			crackBySample(ciphertext, validSolutions);
+		else
+			crack(ciphertext, validSolutions, 0);		// calling helper function
+	}
+
+	// remember the key of an unambiguous answer, and time hits and misses to estimate what the cache saves
+	if (m_keyCacheSize > 0)
+	{
+		double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+		if (keyCacheHit)
+		{
+			m_stats.keyCacheHits++;
+			m_keyCacheHitMs += elapsed;
+		}
+		else
+		{
+			m_stats.keyCacheMisses++;
+			m_keyCacheMissMs += elapsed;
+			if (!m_timedOut && validSolutions.size() == 1)
+				rememberKey(ciphertext, validSolutions[0]);
+		}
+	}
+
+	endCrack(validSolutions);
+    return validSolutions;  
+}
+
+bool DecrypterImpl::crack(const string& ciphertext, const string& checkpointFile, vector<string>& solutions)
+{
+	// the search always runs in full here, without long text sampling or the key cache, so that a resumed
+	// crack makes exactly the same choices as the one that wrote the checkpoint
+	solutions.clear();
+	m_resumeFailure = ResumeFailure::None;
+	vector<unsigned int> next;
+	vector<unsigned int> sizes;
+	bool finished;
+	if (!readCheckpoint(checkpointFile, ciphertext, solutions, next, sizes, finished))
+	{
+		solutions.clear();
+		m_resumeFailure = ResumeFailure::CheckpointUnusable;	// leave the files alone
+		return false;
+	}
+	if (finished)
+	{
+		sort(solutions.begin(), solutions.end());	// the solutions file holds them in the order they were found
+		return true;
+	}
+
+	// drop any solutions appended after the checkpoint was written; the search finds them again
+	string solutionsFile = checkpointFile + SOLUTIONS_SUFFIX;
+	if (truncate(solutionsFile.c_str(), solutions.size() * (ciphertext.size() + 1)) != 0 && !solutions.empty())
+	{
+		solutions.clear();
+		m_resumeFailure = ResumeFailure::CheckpointUnusable;
+		return false;
+	}
+	if (!beginCrack(ciphertext))
+	{
+		if (tokenizedWords.empty())
+			return true;					// there is nothing to crack
+		solutions.clear();
+		m_resumeFailure = ResumeFailure::WordListUnreadable;
+		return false;
+	}
+
+	if (!restoreLevels(next, sizes))
+	{
+		endCrack(solutions);
+		solutions.clear();
+		m_resumeFailure = ResumeFailure::WordListChanged;
+		return false;
+	}
+	m_checkpointFile = checkpointFile;
+	m_lastCheckpoint = chrono::steady_clock::now();
+	m_numSavedSolutions = solutions.size();
+	crack(ciphertext, solutions, next.size());	// writes a checkpoint if it stops early
+	finished = !m_timedOut;
+	if (finished)
+		writeCheckpoint(ciphertext, solutions, 0, true);	// before sorting, so the solutions file is only appended to
+	endCrack(solutions);
+	m_checkpointFile.clear();
+	return finished;
+}
+
+bool DecrypterImpl::beginCrack(const string& ciphertext)
+{
+	m_timedOut = false;
+	if (m_timeLimit > 0)
+		m_deadline = chrono::steady_clock::now() + chrono::milliseconds(m_timeLimit);
+
 	// Step 2:
 	// Tokenize the given ciphertext string
 	tokenizedWords = token.tokenize(ciphertext);			
+	if (tokenizedWords.empty())
+		return false;
+
+	// take a snapshot of the word list; a reload during the crack only affects later cracks, and
+	// the old list is freed once the last crack using it lets go
+	wl = atomic_load(&m_published);
+	if (wl == nullptr)
+		return false;						// unloaded
+	if (!wl->covers(tokenizedWords))
+	{
+		// the list was only partly loaded, for other words; it may be shared, so instead of changing it,
+		// read the whole file into a new list and use that from now on, unless a reload got there first
+		shared_ptr<const WordList> partialList = wl;
+		shared_ptr<WordList> fullList = make_shared<WordList>();
+		if (!fullList->loadWordList(partialList->getFilename()))
+		{
+			wl.reset();
+			return false;
+		}
+		wl = fullList;
+		atomic_compare_exchange_strong(&m_published, &partialList, wl);
+	}
+
+	// count the cipher letter frequencies once so every level can rank its candidates with them
+	for (int i = 0; i < 26; i++)
+		m_cipherFreq[i] = 0;
+	m_numCipherLetters = 0;
+	for (unsigned int i = 0; i < ciphertext.size(); i++)
+	{
+		if (isalpha(ciphertext[i]))
+		{
+			m_cipherFreq[tolower(ciphertext[i]) - 'a']++;
+			m_numCipherLetters++;
+		}
+	}
+	return true;
+}
+
+void DecrypterImpl::endCrack(vector<string>& solutions)
+{
+	if (!solutions.empty())			// sort the vector of valid solutions in alphabetical order
+	{
+		sort(solutions.begin(), solutions.end());
+	}
+
+	// the cache and the levels point into the snapshot, so drop them along with it
+	clearCandidateCache();
+	for (unsigned int i = 0; i < m_levels.size(); i++)
+		m_levels[i].candidates.clear();
+	wl.reset();
+}
 
-	crack(ciphertext, validSolutions);		// calling helper function
+vector<vector<string>> DecrypterImpl::crack(const vector<string>& ciphertexts)
+{
+	// crack the messages as one text, so that every word of every message constrains the one key they share;
+	// a space is a word separator, and translating keeps every character in place, so each solution splits
+	// back into the messages at the same offsets
+	string joined;
+	vector<size_t> offsets;
+	for (unsigned int i = 0; i < ciphertexts.size(); i++)
+	{
+		if (i > 0)
+			joined += ' ';
+		offsets.push_back(joined.size());
+		joined += ciphertexts[i];
+	}
 
-	if (!validSolutions.empty())			// sort the vector of valid solutions in alphabetical order
+	vector<vector<string>> keySolutions;	// for each key that fits, the plaintext of every message
+	if (ciphertexts.empty())
+		return keySolutions;
+	vector<string> solutions = crack(joined);
+	for (unsigned int i = 0; i < solutions.size(); i++)
 	{
-		sort(validSolutions.begin(), validSolutions.end());
+		vector<string> plaintexts;
+		for (unsigned int j = 0; j < ciphertexts.size(); j++)
+			plaintexts.push_back(solutions[i].substr(offsets[j], ciphertexts[j].size()));
+		keySolutions.push_back(plaintexts);
+	}
+	return keySolutions;
+}
+
+void DecrypterImpl::crack(const string& ciphertext, vector<string>& output, unsigned int numLevels)
+{
+	// The search keeps its own stack of levels rather than recursing, so its whole state is which candidate
+	// each level has reached; that is what a checkpoint records
+
+	unsigned int depth = numLevels;		// number of levels on the stack
+	if (depth == 0)
+	{
+		if (!openLevel(0))
+		{
+			t.popMapping();
+			return;
+		}
+		depth = 1;
+	}
+
+	while (depth > 0)
+	{
+		Level& level = m_levels[depth - 1];
+
+		if (outOfTime())
+		{
+			// give up on the rest of the search, keeping what was found so far; a resumable crack
+			// records where it stopped before the levels are unwound
+			if (!m_checkpointFile.empty())
+				writeCheckpoint(ciphertext, output, depth, false);
+			for (; depth > 0; depth--)
+				t.popMapping();
+			break;
+		}
+		if (!m_checkpointFile.empty() &&
+			chrono::steady_clock::now() - m_lastCheckpoint >= chrono::seconds(CHECKPOINT_SECONDS))
+			writeCheckpoint(ciphertext, output, depth, false);
+
+		// if out of possible candidates to check, pop the map and go back to the level above
+		if (level.next == level.candidates.size())
+		{
+			t.popMapping();
+			depth--;
+			continue;
+		}
+
+		// Step 6
+		// try the level's next candidate
+		const string& pickedWord = tokenizedWords[level.pickedWord];
+		if (!t.pushMapping(pickedWord, *level.candidates[level.next++]))		// create temp mapping table by pushing a copy of the mapping table
+			continue;
+
+		unsigned int count = 0;											// count variable holds the number of fully translated words that
+																		// that are found in the wordlist
+		string& translatedCipher = level.translatedCipher;				// holds the translation of the entire ciphertext msg
+		t.getTranslation(ciphertext, translatedCipher);					// get translation of entire ciphertext msg
+		vector<string> translatedCipherTokenized = token.tokenize(translatedCipher);	// tokenize the translated cipher
+		bool wordNotFound = false;										// bool to keep track if a word was not found in wordlist
+		for (unsigned int j = 0; j < translatedCipherTokenized.size(); j++)
+		{
+			bool fullyTranslated = true;							// bool to keep track of whether or not a word is fully translated
+			wordNotFound = false;									// reinitialize
+			string curr = translatedCipherTokenized[j];				// current string we are looking at
+			for (unsigned int k = 0; k < curr.size(); k++)
+			{
+				if (curr[k] == '?')									// if a character in the current string is a '?',
+				{													// it has not been fully translated, so break out of the loop and check other words
+					fullyTranslated = false;
+					break;
+				}
+			}
+			// 6ci)
+			if (fullyTranslated && !wl->contains(curr))	// if word is fully translated but NOT in word list
+			{
+				t.popMapping();			// pop the map
+				wordNotFound = true;
+				break;
+			}
+			else if (fullyTranslated && wl->contains(curr))
+			{
+				count++;			// increment count of fully translated words that are in word list
+			}
+			// a partly translated word containing a letter pair no word has can never be completed
+			else if (m_usePriors && hasImpossibleBigram(curr))
+			{
+				t.popMapping();			// pop the map
+				wordNotFound = true;
+				break;
+			}
+		}
+		if (wordNotFound)
+			continue;				// return to step 6
+
+		if (count < translatedCipherTokenized.size())			// if message has not been completely translated
+		{
+			if (openLevel(depth))								// go one level deeper with the current mapping
+				depth++;
+			else
+				t.popMapping();									// no word fits there, so pop the map
+		}
+		else													// if message has been fully translated and all words in wordlist
+		{
+			// record as valid solution for user
+			output.push_back(translatedCipher);
+			t.popMapping();									// pop the map
+		}
 	}
-	
-    return validSolutions;  
 }
 
-void DecrypterImpl::crack(const string& ciphertext, vector<string>& output)
+bool DecrypterImpl::openLevel(unsigned int depth)
 {
+	if (depth == m_levels.size())
+		m_levels.push_back(Level());
+	Level& level = m_levels[depth];
+
 	// Step 2 (pick word with most untranslated letters)
 	int maxNum = 0;
 	int indexOfMaxNum = 0;
+	string& translatedWord = level.translatedWord;		// reused for every word so translating does not allocate
 	for (unsigned int i = 0; i < tokenizedWords.size(); i++)
 	{
-		string word = tokenizedWords[i];
-		string translated = t.getTranslation(word);
+		const string& word = tokenizedWords[i];
+		t.getTranslation(word, translatedWord);
 		int count = 0;
 		for (unsigned int j = 0; j < word.size(); j++)
 		{
-			if (translated[j] == '?')
+			if (translatedWord[j] == '?')
 				count++;
 		}
 		if (count > maxNum)
@@ -75,75 +509,585 @@ void DecrypterImpl::crack(const string& ciphertext, vector<string>& output)
 
 	// Step 3
 	// get the translation of the picked word
-	string pickedWord = tokenizedWords[indexOfMaxNum];
-	string translatedWord = t.getTranslation(pickedWord);
+	level.pickedWord = indexOfMaxNum;
+	const string& pickedWord = tokenizedWords[indexOfMaxNum];
+	t.getTranslation(pickedWord, translatedWord);
 
 	// Step 4
 	// Find all candidates that fit with the given picked word and translated word
-	vector<string> foundCandidates = wl.findCandidates(pickedWord, translatedWord);
+	findCandidates(pickedWord, translatedWord, level.candidates);
+	level.next = 0;
 
 	// Step 5
-	// if no candidates found, pop and return
-	if (foundCandidates.empty())
+	// if no candidates found, there is nothing to try at this level
+	if (level.candidates.empty())
+		return false;
+
+	// try the candidates whose letter assignments best fit English letter frequencies first
+	if (m_usePriors)
+		rankCandidates(pickedWord, translatedWord, level.candidates);
+	return true;
+}
+
+void DecrypterImpl::crackBySample(const string& ciphertext, vector<string>& output)
+{
+	vector<string> allWords = tokenizedWords;
+
+	// Step 1
+	// collect the distinct words made up only of letters, since only those can be pushed as mappings,
+	// along with how many words in the word list share each one's pattern
+	vector<string> distinctWords;
+	vector<int> numCandidates;
+	for (unsigned int i = 0; i < allWords.size(); i++)
+	{
+		string word = allWords[i];
+		bool onlyLetters = true;
+		for (unsigned int j = 0; j < word.size(); j++)
+		{
+			if (!isalpha(word[j]))
+			{
+				onlyLetters = false;
+				break;
+			}
+			word[j] = tolower(word[j]);
+		}
+		if (!onlyLetters || find(distinctWords.begin(), distinctWords.end(), word) != distinctWords.end())
+			continue;
+
+		int num = wl->countPatternMatches(word);
+		if (num == 0)
+			return;						// no word in the word list fits this word, so the message has no solution
+		distinctWords.push_back(word);
+		numCandidates.push_back(num);
+	}
+
+	// Step 2
+	// greedily pick the word covering the most letters not yet covered, preferring rarer patterns on ties,
+	// until every letter of those words is covered
+	bool covered[26] = { false };
+	vector<bool> used(distinctWords.size(), false);
+	vector<string> sample;
+	string sampleText;
+	for (;;)
+	{
+		int best = -1;
+		int bestNewLetters = 0;
+		for (unsigned int i = 0; i < distinctWords.size(); i++)
+		{
+			if (used[i])
+				continue;
+			bool seen[26] = { false };
+			int newLetters = 0;
+			for (unsigned int j = 0; j < distinctWords[i].size(); j++)
+			{
+				int index = distinctWords[i][j] - 'a';
+				if (!covered[index] && !seen[index])
+					newLetters++;
+				seen[index] = true;
+			}
+			if (best == -1 || newLetters > bestNewLetters ||
+				(newLetters == bestNewLetters && numCandidates[i] < numCandidates[best]))
+			{
+				best = i;
+				bestNewLetters = newLetters;
+			}
+		}
+		if (best == -1 || (bestNewLetters == 0 && sample.size() >= SAMPLE_WORDS))
+			break;						// every letter is covered and the sample is big enough to prune well
+
+		used[best] = true;
+		for (unsigned int j = 0; j < distinctWords[best].size(); j++)
+			covered[distinctWords[best][j] - 'a'] = true;
+		sample.push_back(distinctWords[best]);
+		if (!sampleText.empty())
+			sampleText += ' ';
+		sampleText += distinctWords[best];
+	}
+
+	if (sample.empty())
 	{
+		crack(ciphertext, output, 0);		// nothing to sample, so search the whole message
+		return;
+	}
+
+	// Step 3
+	// solve the key on the sample alone
+	vector<string> sampleSolutions;
+	tokenizedWords = sample;
+	crack(sampleText, sampleSolutions, 0);
+	tokenizedWords = allWords;
+
+	// Step 4
+	// check every key found against the full message in a single pass
+	string translatedCipher;
+	for (unsigned int i = 0; i < sampleSolutions.size() && !outOfTime(); i++)
+	{
+		string cipherLetters;
+		string plainLetters;
+		for (unsigned int j = 0; j < sampleText.size(); j++)
+		{
+			if (isalpha(sampleText[j]))
+			{
+				cipherLetters += sampleText[j];
+				plainLetters += sampleSolutions[i][j];
+			}
+		}
+		if (!t.pushMapping(cipherLetters, plainLetters))
+			continue;
+
+		t.getTranslation(ciphertext, translatedCipher);
+		if (translatedCipher.find('?') != string::npos)
+		{
+			// some letters only occur in words that could not be sampled, so keep searching
+			// the whole message from this key; a search started with no levels pops it when done
+			crack(ciphertext, output, 0);
+			continue;
+		}
+
+		vector<string> translatedCipherTokenized = token.tokenize(translatedCipher);
+		bool allFound = true;
+		for (unsigned int j = 0; j < translatedCipherTokenized.size(); j++)
+		{
+			if (!wl->contains(translatedCipherTokenized[j]))
+			{
+				allFound = false;
+				break;
+			}
+		}
+		if (allFound)
+			output.push_back(translatedCipher);
 		t.popMapping();
-		return;				// this should exit the recursive call
 	}
+}
+
+void DecrypterImpl::setFrequencyPriors(bool enabled)
+{
+	m_usePriors = enabled;
+}
+
+void DecrypterImpl::setLongTextMode(bool enabled)
+{
+	m_useLongTextMode = enabled;
+}
+
+void DecrypterImpl::setTimeLimit(int milliseconds)
+{
+	m_timeLimit = (milliseconds > 0 ? milliseconds : 0);
+}
+
+void DecrypterImpl::setKeyCacheSize(int numKeys)
+{
+	m_keyCacheSize = (numKeys > 0 ? numKeys : 0);
+	while (m_keys.size() > m_keyCacheSize)
+		m_keys.pop_back();
+}
 
-	// Step 6
-	// iterate through the foundCandidates vector
-	int count = 0;
-	for (unsigned int i = 0; i < foundCandidates.size(); i++)
+bool DecrypterImpl::timedOut() const
+{
+	return m_timedOut;
+}
+
+ResumeFailure DecrypterImpl::resumeFailure() const
+{
+	return m_resumeFailure;
+}
+
+DecrypterStats DecrypterImpl::getStats() const
+{
+	// every hit is assumed to have saved the difference between an average miss and an average hit
+	DecrypterStats stats = m_stats;
+	if (stats.keyCacheHits > 0 && stats.keyCacheMisses > 0)
+	{
+		double saved = m_keyCacheMissMs / stats.keyCacheMisses - m_keyCacheHitMs / stats.keyCacheHits;
+		stats.keyCacheSavedMs = max(0.0, saved * stats.keyCacheHits);
+	}
+	return stats;
+}
+
+//////////////////////////////////////////
+// Helper functions
+//////////////////////////////////////////
+
+void DecrypterImpl::findCandidates(const string& cipherWord, const string& translatedWord, vector<const string*>& candidates)
+{
+	// the candidates of a word only depend on its letter pattern and on which letters are already known
+	m_pattern.assign(cipherWord);
+	m_known.assign(translatedWord);
+	char patternChars[26] = { 0 };
+	char nextPatternChar = 'a';
+	for (unsigned int i = 0; i < cipherWord.size(); i++)
 	{
-		if (t.pushMapping(pickedWord, foundCandidates[i]))					// create temp mapping table by pushing a copy of the mapping table
+		char c = tolower(cipherWord[i]);
+		if (isalpha(c))
 		{
-			count = 0;														// count variable holds the number of fully translated words that
-																			// that are found in the wordlist
-			string translatedCipher = t.getTranslation(ciphertext);			// get translation of entire ciphertext msg
-			vector<string> translatedCipherTokenized = token.tokenize(translatedCipher);	// tokenize the translated cipher
-			bool wordNotFound = false;												// bool to keep track if a word was not found in wordlist
-			for (unsigned int j = 0; j < translatedCipherTokenized.size(); j++)
+			if (patternChars[c - 'a'] == 0)
+				patternChars[c - 'a'] = nextPatternChar++;
+			c = patternChars[c - 'a'];
+		}
+		m_pattern[i] = c;
+		m_known[i] = tolower(translatedWord[i]);
+	}
+	m_cacheKey.assign(m_pattern);
+	m_cacheKey += '|';
+	m_cacheKey += m_known;
+
+	const vector<const string*>* cached = m_candidateCache.find(m_cacheKey);
+	if (cached != nullptr)
+	{
+		m_stats.candidateCacheHits++;
+		candidates.assign(cached->begin(), cached->end());
+		return;
+	}
+
+	// a cached entry for the same pattern that knows a subset of these letters holds every candidate,
+	// so filter the smallest such entry instead of scanning the word list again
+	const vector<const string*>* broader = nullptr;
+	const vector<string>* translations = m_cachedTranslations.find(m_pattern);
+	if (translations != nullptr)
+	{
+		for (unsigned int i = 0; i < translations->size(); i++)
+		{
+			const string& other = (*translations)[i];
+			bool isBroader = true;
+			for (unsigned int j = 0; j < other.size() && isBroader; j++)
 			{
-				bool fullyTranslated = true;							// bool to keep track of whether or not a word is fully translated
-				wordNotFound = false;									// reinitialize
-				string curr = translatedCipherTokenized[j];				// current string we are looking at
-				for (unsigned int k = 0; k < curr.size(); k++)
-				{
-					if (curr[k] == '?')									// if a character in the current string is a '?',
-					{													// it has not been fully translated, so break out of the loop and check other words
-						fullyTranslated = false;
-						break;
-					}
-				}
-				// 6ci)
-				if (fullyTranslated && !wl.contains(curr))	// if word is fully translated but NOT in word list
-				{
-					t.popMapping();			// pop the map
-					wordNotFound = true;
-					break;
-				}
-				else if (fullyTranslated && wl.contains(curr))
-				{
-					count++;			// increment count of fully translated words that are in word list
-				}
+				if (other[j] != '?' && other[j] != m_known[j])
+					isBroader = false;
 			}
-			if (wordNotFound)
-				continue;				// return to step 6
+			if (!isBroader)
+				continue;
+			m_cacheKey.assign(m_pattern);
+			m_cacheKey += '|';
+			m_cacheKey += other;
+			const vector<const string*>* entry = m_candidateCache.find(m_cacheKey);
+			if (entry != nullptr && (broader == nullptr || entry->size() < broader->size()))
+				broader = entry;
+		}
+	}
 
-			if (count < translatedCipherTokenized.size())			// if message has not been completely translated
-			{	
-				crack(ciphertext, output);							// recursive call with current mapping
+	if (broader != nullptr)
+	{
+		m_stats.candidateCacheFiltered++;
+		candidates.clear();
+		for (unsigned int i = 0; i < broader->size(); i++)
+		{
+			const string& curr = *(*broader)[i];
+			bool isCandidate = true;
+			for (unsigned int j = 0; j < m_known.size() && isCandidate; j++)
+			{
+				if (isalpha(m_known[j]) && curr[j] != m_known[j])
+					isCandidate = false;
 			}
-			if (count == translatedCipherTokenized.size())		// if message has been fully translated and all words in wordlist
+			if (isCandidate)
+				candidates.push_back(&curr);
+		}
+	}
+	else
+	{
+		m_stats.candidateCacheMisses++;
+		wl->findCandidates(cipherWord, translatedWord, candidates);
+	}
+
+	// keep the cache bounded by starting over once it gets too big
+	if (m_numCachedCandidates + (int)candidates.size() > CANDIDATE_CACHE_WORDS ||
+		m_candidateCache.getNumItems() >= CANDIDATE_CACHE_ENTRIES || m_numCachedTranslations >= CANDIDATE_CACHE_ENTRIES)
+		clearCandidateCache();
+	m_cacheKey.assign(m_pattern);
+	m_cacheKey += '|';
+	m_cacheKey += m_known;
+	m_candidateCache.associate(m_cacheKey, candidates);
+	m_numCachedCandidates += candidates.size();
+	vector<string>* knownList = m_cachedTranslations.find(m_pattern);
+	if (knownList == nullptr)
+	{
+		m_cachedTranslations.associate(m_pattern, vector<string>(1, m_known));
+		m_numCachedTranslations++;
+	}
+	else if (knownList->size() < BROADER_ENTRIES_PER_PATTERN)		// keeps the scan for a broader entry short
+	{
+		knownList->push_back(m_known);
+		m_numCachedTranslations++;
+	}
+}
+
+void DecrypterImpl::clearCandidateCache()
+{
+	m_candidateCache.reset();
+	m_cachedTranslations.reset();
+	m_numCachedCandidates = 0;
+	m_numCachedTranslations = 0;
+}
+
+void DecrypterImpl::rankCandidates(const string& cipherWord, const string& translatedWord, vector<const string*>& candidates)
+{
+	// score each candidate by how likely the observed count of every cipher letter it newly assigns
+	// would be if that letter really stood for the plaintext letter (binomial log-likelihood)
+	m_scores.clear();
+	for (unsigned int i = 0; i < candidates.size(); i++)
+	{
+		const string& candidate = *candidates[i];
+		bool counted[26] = { false };			// each cipher letter only contributes once per candidate
+		double score = 0;
+		for (unsigned int j = 0; j < translatedWord.size(); j++)
+		{
+			if (translatedWord[j] != '?')
+				continue;
+			int cipherIndex = tolower(cipherWord[j]) - 'a';
+			if (counted[cipherIndex])
+				continue;
+			counted[cipherIndex] = true;
+			double p = ENGLISH_LETTER_FREQ[candidate[j] - 'a'] / 100;
+			score += m_cipherFreq[cipherIndex] * log(p) + (m_numCipherLetters - m_cipherFreq[cipherIndex]) * log(1 - p);
+		}
+		m_scores.push_back(make_pair(-score, i));
+	}
+
+	// most plausible first; ties are broken by index so that equally scored candidates keep word list order
+	sort(m_scores.begin(), m_scores.end());
+
+	m_ranked.clear();
+	for (unsigned int i = 0; i < m_scores.size(); i++)
+		m_ranked.push_back(candidates[m_scores[i].second]);
+	candidates.assign(m_ranked.begin(), m_ranked.end());
+}
+
+bool DecrypterImpl::outOfTime()
+{
+	if (m_timeLimit == 0)
+		return false;
+	if (!m_timedOut && chrono::steady_clock::now() >= m_deadline)
+		m_timedOut = true;
+	return m_timedOut;
+}
+
+bool DecrypterImpl::tryCachedKeys(const string& ciphertext, vector<string>& output)
+{
+	list<string>::iterator firstFit = m_keys.end();
+	for (list<string>::iterator it = m_keys.begin(); it != m_keys.end(); it++)
+	{
+		const string& key = *it;
+		m_keyCipher.clear();
+		m_keyPlain.clear();
+		for (int i = 0; i < 26; i++)
+		{
+			if (key[i] != '?')
 			{
-				// record as valid solution for user
-				output.push_back(translatedCipher);
-				t.popMapping();									// pop the map
+				m_keyCipher += char('a' + i);
+				m_keyPlain += key[i];
 			}
 		}
+		if (!m_keyTranslator.pushMapping(m_keyCipher, m_keyPlain))
+			continue;
+
+		// the key fits if it translates every word completely into a word from the word list
+		bool fits = true;
+		for (unsigned int i = 0; i < tokenizedWords.size() && fits; i++)
+		{
+			m_keyTranslator.getTranslation(tokenizedWords[i], m_keyWord);
+			if (m_keyWord.find('?') != string::npos || !wl->contains(m_keyWord))
+				fits = false;
+		}
+		if (fits)
+		{
+			string translation = m_keyTranslator.getTranslation(ciphertext);
+			if (find(output.begin(), output.end(), translation) == output.end())
+				output.push_back(translation);		// keys differing only in letters this message lacks agree here
+			if (firstFit == m_keys.end())
+				firstFit = it;
+		}
+		m_keyTranslator.popMapping();
 	}
-	t.popMapping();				// if out of possible candidates to check, pop the map and return
-	return;
+
+	if (firstFit == m_keys.end())
+		return false;
+	if (output.size() > 1)
+	{
+		output.clear();						// cached keys disagree about this message, so let the search decide
+		return false;
+	}
+	m_keys.splice(m_keys.begin(), m_keys, firstFit);		// move to the front of the LRU order
+	return true;
+}
+
+void DecrypterImpl::rememberKey(const string& ciphertext, const string& plaintext)
+{
+	string key(26, '?');
+	for (unsigned int i = 0; i < ciphertext.size(); i++)
+	{
+		if (isalpha(ciphertext[i]))
+			key[tolower(ciphertext[i]) - 'a'] = tolower(plaintext[i]);
+	}
+
+	// a key agreeing with a cached one on many letters and contradicting it on none is the same key, so
+	// fill in the letters the cached one was missing instead of caching it twice
+	for (list<string>::iterator it = m_keys.begin(); it != m_keys.end(); it++)
+	{
+		string& cached = *it;
+		int overlap = 0;
+		bool contradicts = false;
+		for (int i = 0; i < 26 && !contradicts; i++)
+		{
+			if (key[i] == '?')
+				continue;
+			for (int j = 0; j < 26; j++)
+			{
+				if (j == i)
+				{
+					if (cached[j] == key[i])
+						overlap++;
+					else if (cached[j] != '?')
+						contradicts = true;
+				}
+				else if (cached[j] == key[i])
+					contradicts = true;				// some other cipher letter already stands for this one
+			}
+		}
+		if (overlap >= KEY_MERGE_MIN_OVERLAP && !contradicts)
+		{
+			for (int i = 0; i < 26; i++)
+			{
+				if (key[i] != '?')
+					cached[i] = key[i];
+			}
+			m_keys.splice(m_keys.begin(), m_keys, it);
+			return;
+		}
+	}
+
+	m_keys.push_front(key);
+	if (m_keys.size() > m_keyCacheSize)
+		m_keys.pop_back();				// evict the least recently used key
+}
+
+bool DecrypterImpl::writeCheckpoint(const string& ciphertext, const vector<string>& output, unsigned int numLevels, bool finished)
+{
+	m_lastCheckpoint = chrono::steady_clock::now();
+
+	// solutions are only ever added, so the new ones are appended to the solutions file rather than written out
+	// again each time; the checkpoint records how long that file was, and a resumed crack cuts it back to that
+	string solutionsFile = m_checkpointFile + SOLUTIONS_SUFFIX;
+	size_t solutionBytes = ciphertext.size() + 1;		// every solution is as long as the message, plus a newline
+	ofstream solutionsOut(solutionsFile, ios::binary | ios::app);
+	if (!solutionsOut)
+		return false;
+	for (unsigned int i = m_numSavedSolutions; i < output.size(); i++)
+		solutionsOut << output[i] << "\n";
+	solutionsOut.close();
+	if (!solutionsOut)
+	{
+		truncate(solutionsFile.c_str(), m_numSavedSolutions * solutionBytes);	// so the next try appends in the right place
+		return false;
+	}
+	m_numSavedSolutions = output.size();
+
+	// write a new file and rename it over the old one, so that a crash while writing leaves the old one intact
+	string tempFile = m_checkpointFile + ".tmp";
+	ofstream outfile(tempFile, ios::binary);
+	if (!outfile)
+		return false;
+	outfile << CHECKPOINT_HEADER << "\n"
+		<< "priors " << m_usePriors << "\n"
+		<< "message " << ciphertext.size() << "\n" << ciphertext << "\n"
+		<< "levels " << numLevels << "\n";
+	for (unsigned int i = 0; i < numLevels; i++)
+		outfile << m_levels[i].next << " " << m_levels[i].candidates.size() << "\n";
+	outfile << "solutions " << output.size() << " " << output.size() * solutionBytes << "\n"
+		<< "finished " << finished << "\n";
+	outfile.close();
+	if (!outfile)
+		return false;
+	return rename(tempFile.c_str(), m_checkpointFile.c_str()) == 0;
+}
+
+bool DecrypterImpl::readCheckpoint(const string& checkpointFile, const string& ciphertext, vector<string>& output,
+	vector<unsigned int>& next, vector<unsigned int>& sizes, bool& finished)
+{
+	finished = false;
+	ifstream infile(checkpointFile, ios::binary);
+	if (!infile)
+		return true;						// no checkpoint yet, so start from the beginning
+
+	// the search only takes the same path again with the same message and the same ranking
+	string line;
+	string label;
+	bool usePriors;
+	size_t length;
+	if (!getline(infile, line) || line != CHECKPOINT_HEADER)
+		return false;
+	if (!(infile >> label >> usePriors) || label != "priors" || usePriors != m_usePriors)
+		return false;
+	if (!(infile >> label >> length) || label != "message" || length != ciphertext.size())
+		return false;
+	infile.get();
+	string message(length, ' ');
+	if (!infile.read(&message[0], length) || message != ciphertext)
+		return false;
+
+	unsigned int numLevels;
+	if (!(infile >> label >> numLevels) || label != "levels")
+		return false;
+	for (unsigned int i = 0; i < numLevels; i++)
+	{
+		unsigned int levelNext;
+		unsigned int levelSize;
+		if (!(infile >> levelNext >> levelSize))
+			return false;
+		next.push_back(levelNext);
+		sizes.push_back(levelSize);
+	}
+
+	unsigned int numSolutions;
+	size_t solutionsLength;
+	if (!(infile >> label >> numSolutions >> solutionsLength) || label != "solutions" ||
+		solutionsLength != numSolutions * (length + 1))	// every solution is as long as the message, plus a newline
+		return false;
+	if (!(infile >> label >> finished) || label != "finished")
+		return false;
+
+	// the solutions file may run on past the recorded length, but must not stop short of it
+	ifstream solutionsIn(checkpointFile + SOLUTIONS_SUFFIX, ios::binary);
+	string solution(length, ' ');
+	for (unsigned int i = 0; i < numSolutions; i++)
+	{
+		if (!solutionsIn.read(&solution[0], length) || solutionsIn.get() != '\n')
+			return false;
+		output.push_back(solution);
+	}
+	return true;
+}
+
+bool DecrypterImpl::restoreLevels(const vector<unsigned int>& next, const vector<unsigned int>& sizes)
+{
+	// set the levels up again from the top, pushing the candidate each one had reached; the word picked and
+	// the candidates found are the same as before as long as the word list is, which the candidate counts check
+	for (unsigned int depth = 0; depth < next.size(); depth++)
+	{
+		bool restored = openLevel(depth);
+		Level& level = m_levels[depth];
+		restored = restored && level.candidates.size() == sizes[depth] && next[depth] <= sizes[depth];
+		if (restored)
+			level.next = next[depth];
+		if (restored && depth + 1 < next.size())
+			restored = (next[depth] > 0 && t.pushMapping(tokenizedWords[level.pickedWord], *level.candidates[next[depth] - 1]));
+		if (!restored)
+		{
+			for (; depth > 0; depth--)
+				t.popMapping();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool DecrypterImpl::hasImpossibleBigram(const string& translatedWord) const
+{
+	for (unsigned int i = 1; i < translatedWord.size(); i++)
+	{
+		if (isalpha(translatedWord[i - 1]) && isalpha(translatedWord[i]) &&
+			!wl->containsBigram(translatedWord[i - 1], translatedWord[i]))
+			return true;
+	}
+	return false;
 }
 
 //******************** Decrypter functions ************************************
@@ -166,7 +1110,72 @@ bool Decrypter::load(string filename)
     return m_impl->load(filename);
 }
 
+bool Decrypter::load(string filename, const string& ciphertext)
+{
+    return m_impl->load(filename, ciphertext);
+}
+
+bool Decrypter::load(shared_ptr<const WordList> wordList)
+{
+    return m_impl->load(wordList);
+}
+
+bool Decrypter::reload(string filename)
+{
+    return m_impl->reload(filename);
+}
+
+void Decrypter::unload()
+{
+    m_impl->unload();
+}
+
 vector<string> Decrypter::crack(const string& ciphertext)
 {
    return m_impl->crack(ciphertext);
 }
+
+vector<vector<string>> Decrypter::crack(const vector<string>& ciphertexts)
+{
+   return m_impl->crack(ciphertexts);
+}
+
+bool Decrypter::crack(const string& ciphertext, const string& checkpointFile, vector<string>& solutions)
+{
+   return m_impl->crack(ciphertext, checkpointFile, solutions);
+}
+
+ResumeFailure Decrypter::resumeFailure() const
+{
+    return m_impl->resumeFailure();
+}
+
+void Decrypter::setFrequencyPriors(bool enabled)
+{
+    m_impl->setFrequencyPriors(enabled);
+}
+
+void Decrypter::setLongTextMode(bool enabled)
+{
+    m_impl->setLongTextMode(enabled);
+}
+
+void Decrypter::setTimeLimit(int milliseconds)
+{
+    m_impl->setTimeLimit(milliseconds);
+}
+
+void Decrypter::setKeyCacheSize(int numKeys)
+{
+    m_impl->setKeyCacheSize(numKeys);
+}
+
+bool Decrypter::timedOut() const
+{
+    return m_impl->timedOut();
+}
+
+DecrypterStats Decrypter::getStats() const
+{
+    return m_impl->getStats();
+}
@@ -3,6 +3,25 @@
 // Skeleton for the MyHash class template.  You must implement the first seven
 // member functions; we have implemented the eighth.
 
+#include <vector>
+#include <chrono>
+#include <cstddef>
+
+// A snapshot of how a MyHash is laid out, for tuning the load factor and checking the hash function
+struct HashStats
+{
+	int numItems;
+	unsigned int numBuckets;
+	double loadFactor;
+	double maxLoadFactor;
+	unsigned int emptyBuckets;
+	unsigned int longestChain;
+	std::vector<unsigned int> chainLengths;		// chainLengths[n] is the number of buckets holding exactly n items
+	int numRehashes;							// times the table has grown since it was created or last reset
+	double rehashSeconds;						// total time spent growing the table
+	std::size_t bytesUsed;						// estimate of the heap memory used by the table, nodes, keys and values
+};
+
 template<typename KeyType, typename ValueType>
 class MyHash
 {
@@ -13,6 +32,7 @@ public:
     void associate(const KeyType& key, const ValueType& value);
     int getNumItems() const;
     double getLoadFactor() const;
+    HashStats getStats() const;
 
       // for a map that can't be modified, return a pointer to const ValueType
     const ValueType* find(const KeyType& key) const;
@@ -46,12 +66,14 @@ private:
 	int m_numItems;
 	double m_maxLoadFactor;
 	unsigned int m_numBuckets;
+	int m_numRehashes;		// number of times the table has grown
+	double m_rehashSeconds;	// total time spent growing the table
 
 };
 
 template<typename KeyType, typename ValueType>
 MyHash<KeyType, ValueType>::MyHash(double maxLoadFactor)
-	: m_numBuckets(100), m_numItems(0)
+	: m_numItems(0), m_numBuckets(100), m_numRehashes(0), m_rehashSeconds(0)
 {
 	// check the bounds of the maximum load factor passed in
 	m_hashTable = new Node*[100]();
@@ -76,6 +98,8 @@ void MyHash<KeyType, ValueType>::reset()
 	// reset all the data members and create a new table
 	m_numBuckets = 100;
 	m_numItems = 0;
+	m_numRehashes = 0;
+	m_rehashSeconds = 0;
 	m_hashTable = new Node*[m_numBuckets]();
 }
 
@@ -101,6 +125,8 @@ void MyHash<KeyType, ValueType>::associate(const KeyType &key, const ValueType &
 
 	if (getLoadFactor() > m_maxLoadFactor)		// if load factor has exceed the maximum
 	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
 		// dynamically allocate a new array that is twice the size of the current array
 		unsigned int newNumBuckets = 2 * m_numBuckets;
 		Node** newArray = new Node*[newNumBuckets]();
@@ -128,6 +154,9 @@ void MyHash<KeyType, ValueType>::associate(const KeyType &key, const ValueType &
 		// have m_hashTable store the pointer to the new array and update the bucket count
 		m_hashTable = newArray;
 		m_numBuckets = newNumBuckets;
+
+		m_numRehashes++;
+		m_rehashSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 	}
 }
 
@@ -164,6 +193,43 @@ double MyHash<KeyType, ValueType>::getLoadFactor() const
 	return (m_numItems * 1.0 / m_numBuckets);		// returns current load factor of hash table
 }
 
+template<typename KeyType, typename ValueType>
+HashStats MyHash<KeyType, ValueType>::getStats() const
+{
+	std::size_t heapSize(const KeyType& k);		// prototypes
+	std::size_t heapSize(const ValueType& v);
+
+	HashStats stats;
+	stats.numItems = m_numItems;
+	stats.numBuckets = m_numBuckets;
+	stats.loadFactor = getLoadFactor();
+	stats.maxLoadFactor = m_maxLoadFactor;
+	stats.emptyBuckets = 0;
+	stats.longestChain = 0;
+	stats.numRehashes = m_numRehashes;
+	stats.rehashSeconds = m_rehashSeconds;
+	stats.bytesUsed = m_numBuckets * sizeof(Node*);		// the bucket array itself
+
+	for (unsigned int i = 0; i < m_numBuckets; i++)		// walk every chain, counting its length and the memory its nodes own
+	{
+		unsigned int length = 0;
+		for (Node* p = m_hashTable[i]; p != nullptr; p = p->next)
+		{
+			length++;
+			stats.bytesUsed += sizeof(Node) + heapSize(p->m_key) + heapSize(p->m_value);
+		}
+
+		if (length == 0)
+			stats.emptyBuckets++;
+		if (length > stats.longestChain)
+			stats.longestChain = length;
+		if (length >= stats.chainLengths.size())
+			stats.chainLengths.resize(length + 1, 0);
+		stats.chainLengths[length]++;
+	}
+	return stats;
+}
+
 //////////////////////////////////////////
 // Helper functions
 //////////////////////////////////////////
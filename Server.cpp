@@ -0,0 +1,713 @@
+#include "provided.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+using namespace std;
+
+// Every message between client and server is a frame: a 4-byte big-endian payload length followed by
+// the payload.  A request payload starts with a command byte, a response payload with a status byte.
+const char CMD_CRACK = 'C';			// followed by a 4-byte time limit in ms (0 = server default) and the ciphertext
+const char CMD_STATS = 'S';			// no arguments
+const char CMD_RELOAD = 'R';		// followed by the name of the word list file to switch to
+const char STATUS_OK = 'O';			// followed by the solutions, one per line
+const char STATUS_TIMEOUT = 'T';	// followed by the solutions found before the time limit ran out
+const char STATUS_TRUNCATED = 'P';	// followed by as many solutions as fit in one frame
+const char STATUS_BUSY = 'B';		// the request queue was full, so the request was not accepted
+const char STATUS_ERROR = 'E';		// followed by an error message
+
+const uint32_t MAX_FRAME_SIZE = 16 * 1024 * 1024;	// frames larger than this are treated as a protocol error
+const unsigned int LATENCY_SAMPLES = 1024;			// number of recent request latencies kept for percentiles
+const unsigned int MAX_CONNECTIONS = 256;			// connections beyond this are answered busy and closed
+const int ACCEPT_RETRY_MS = 100;					// pause before accepting again after accept() failed
+const int WORKER_KEY_CACHE_SIZE = 16;				// recently recovered keys each worker tries before searching
+
+//////////////////////////////////////////
+// Helper functions shared by server and client
+//////////////////////////////////////////
+
+static void putUint32(string& s, uint32_t n)
+{
+	s += static_cast<char>((n >> 24) & 0xFF);
+	s += static_cast<char>((n >> 16) & 0xFF);
+	s += static_cast<char>((n >> 8) & 0xFF);
+	s += static_cast<char>(n & 0xFF);
+}
+
+static uint32_t getUint32(const char* p)
+{
+	const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+	return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16) | (uint32_t(u[2]) << 8) | uint32_t(u[3]);
+}
+
+static bool readFully(int fd, char* buffer, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t n = ::recv(fd, buffer, size, 0);
+		if (n <= 0)
+			return false;				// connection closed or failed
+		buffer += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool writeFully(int fd, const char* buffer, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t n = ::send(fd, buffer, size, MSG_NOSIGNAL);		// a vanished peer must not kill the process
+		if (n <= 0)
+			return false;
+		buffer += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool readFrame(int fd, string& payload)
+{
+	char header[4];
+	if (!readFully(fd, header, 4))
+		return false;
+	uint32_t size = getUint32(header);
+	if (size > MAX_FRAME_SIZE)
+		return false;
+	payload.resize(size);
+	return size == 0 || readFully(fd, &payload[0], size);
+}
+
+static bool writeFrame(int fd, const string& payload)
+{
+	string frame;
+	putUint32(frame, payload.size());
+	frame += payload;
+	return writeFully(fd, frame.data(), frame.size());
+}
+
+// An address made up only of digits is a TCP port on the loopback interface;
+// anything else is the path of a Unix domain socket.
+static bool isPortAddress(const string& address)
+{
+	if (address.empty())
+		return false;
+	for (unsigned int i = 0; i < address.size(); i++)
+	{
+		if (!isdigit(address[i]))
+			return false;
+	}
+	return true;
+}
+
+static int openSocket(const string& address, bool listening)
+{
+	bool isPort = isPortAddress(address);
+	int fd;
+	int result;
+	if (isPort)
+	{
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(atoi(address.c_str()));
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		fd = ::socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0)
+			return -1;
+		if (listening)
+		{
+			int yes = 1;
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+			result = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+		}
+		else
+			result = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+	}
+	else
+	{
+		sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (address.size() >= sizeof(addr.sun_path))
+			return -1;
+		strcpy(addr.sun_path, address.c_str());
+
+		fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+			return -1;
+		if (listening)
+		{
+			::unlink(address.c_str());		// remove a socket file left behind by an earlier server
+			result = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+		}
+		else
+			result = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+	}
+
+	if (result < 0 || (listening && ::listen(fd, SOMAXCONN) < 0))
+	{
+		::close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+//******************** ServerImpl ************************************
+
+class ServerImpl
+{
+public:
+	ServerImpl(int numWorkers, int maxQueued, int timeLimit);
+	~ServerImpl();
+	bool load(string filename);
+	bool reload(string filename);
+	bool run(string address);
+	void stop();
+private:
+	struct Job
+	{
+		string ciphertext;
+		int timeLimit;								// milliseconds, counted from when the request was received
+		chrono::steady_clock::time_point received;
+		promise<string> response;					// response payload, filled in by a worker
+	};
+
+	// Helper functions
+	void serveConnection(int fd);					// answers requests on one client connection until it closes
+	void work(int worker);							// worker thread body
+	string getStats();
+	void recordLatency(double milliseconds);		// must be called with m_mutex held
+
+	shared_ptr<const WordList> m_wordList;			// the warm word list shared by every worker; only accessed
+													// through atomic_load/atomic_store so reloads never take m_mutex
+	int m_numWorkers;
+	unsigned int m_maxQueued;
+	int m_timeLimit;								// default per-request time limit in milliseconds
+	int m_listenFd;
+	atomic<bool> m_stopping;
+	atomic<bool> m_reloading;						// true while a reload is building its new word list
+	atomic<long> m_numReloads;
+	bool m_remoteReload;							// whether clients may ask for reloads; only on a Unix socket,
+													// where the socket file's permissions decide who can connect
+
+	mutex m_mutex;									// guards everything below
+	condition_variable m_queueChanged;				// signalled when a job is queued or the server stops
+	condition_variable m_connectionsChanged;		// signalled when a connection closes
+	deque<shared_ptr<Job>> m_queue;					// crack requests waiting for a worker
+	set<int> m_connections;							// open client connections
+	int m_numBusy;									// workers currently cracking
+	long m_numCompleted;
+	long m_numTimedOut;
+	long m_numRejected;
+	long m_numRefused;								// connections closed because MAX_CONNECTIONS were open
+	vector<double> m_latencies;						// ring buffer of recent latencies in milliseconds
+	vector<DecrypterStats> m_workerStats;			// each worker's Decrypter stats as of its last job
+	unsigned int m_nextLatency;						// where the next latency goes in m_latencies
+};
+
+ServerImpl::ServerImpl(int numWorkers, int maxQueued, int timeLimit)
+	: m_wordList(make_shared<WordList>()), m_numWorkers(numWorkers), m_maxQueued(maxQueued), m_timeLimit(timeLimit),
+	  m_listenFd(-1), m_stopping(false), m_reloading(false), m_numReloads(0), m_remoteReload(false), m_numBusy(0), m_numCompleted(0), m_numTimedOut(0), m_numRejected(0), m_numRefused(0), m_nextLatency(0)
+{
+	if (m_numWorkers <= 0)
+		m_numWorkers = max(1u, thread::hardware_concurrency());
+	if (maxQueued < 1)
+		m_maxQueued = 1;
+	if (m_timeLimit < 0)
+		m_timeLimit = 0;
+}
+
+ServerImpl::~ServerImpl()
+{
+	stop();
+}
+
+bool ServerImpl::load(string filename)
+{
+	shared_ptr<WordList> newList = make_shared<WordList>();
+	if (!newList->loadWordList(filename))
+		return false;
+	atomic_store(&m_wordList, shared_ptr<const WordList>(newList));
+	return true;
+}
+
+bool ServerImpl::reload(string filename)
+{
+	// the new list is built on the calling thread while workers keep cracking with the old one;
+	// each worker picks up the new list at its next job, and the old one is freed when the last
+	// job using it finishes
+	bool expected = false;
+	if (!m_reloading.compare_exchange_strong(expected, true))
+		return false;						// one reload at a time
+	bool loaded = load(filename);
+	if (loaded)
+		m_numReloads++;
+	m_reloading = false;
+	return loaded;
+}
+
+bool ServerImpl::run(string address)
+{
+	int listenFd = openSocket(address, true);
+	if (listenFd < 0)
+		return false;
+	m_remoteReload = !isPortAddress(address);		// any local user can reach a TCP port
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_listenFd = listenFd;
+		if (m_stopping)
+			::shutdown(m_listenFd, SHUT_RDWR);
+	}
+
+	vector<thread> workers;
+	DecrypterStats noStats = { 0, 0, 0, 0, 0, 0 };
+	m_workerStats.assign(m_numWorkers, noStats);
+	for (int i = 0; i < m_numWorkers; i++)
+		workers.push_back(thread(&ServerImpl::work, this, i));
+
+	// accept connections until stop() shuts the listening socket down
+	while (!m_stopping)
+	{
+		int fd = ::accept(m_listenFd, nullptr, nullptr);
+		if (fd < 0)
+		{
+			// out of file descriptors or memory: give connections time to close instead of spinning
+			if (errno != EINTR && errno != ECONNABORTED && !m_stopping)
+				this_thread::sleep_for(chrono::milliseconds(ACCEPT_RETRY_MS));
+			continue;
+		}
+		lock_guard<mutex> lock(m_mutex);
+		if (m_stopping)
+		{
+			::close(fd);
+			break;
+		}
+		if (m_connections.size() >= MAX_CONNECTIONS)
+		{
+			// every connection has a thread and a frame buffer, so their number is bounded like the queue
+			writeFrame(fd, string(1, STATUS_BUSY));
+			::close(fd);
+			m_numRefused++;
+			continue;
+		}
+		m_connections.insert(fd);
+		thread(&ServerImpl::serveConnection, this, fd).detach();
+	}
+
+	// let the workers finish the jobs they hold, then fail whatever is still queued
+	m_queueChanged.notify_all();
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	unique_lock<mutex> lock(m_mutex);
+	while (!m_queue.empty())
+	{
+		m_queue.front()->response.set_value(string(1, STATUS_ERROR) + "server is shutting down");
+		m_queue.pop_front();
+	}
+	for (set<int>::iterator it = m_connections.begin(); it != m_connections.end(); it++)
+		::shutdown(*it, SHUT_RDWR);			// wakes connection threads blocked reading their next request
+	m_connectionsChanged.wait(lock, [this] { return m_connections.empty(); });
+
+	::close(m_listenFd);
+	m_listenFd = -1;
+	lock.unlock();
+	if (!isPortAddress(address))
+		::unlink(address.c_str());
+	return true;
+}
+
+void ServerImpl::stop()
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (m_stopping)
+		return;
+	m_stopping = true;
+	if (m_listenFd >= 0)
+		::shutdown(m_listenFd, SHUT_RDWR);		// makes the blocked accept() in run() return
+	m_queueChanged.notify_all();
+}
+
+void ServerImpl::serveConnection(int fd)
+{
+	string request;
+	while (readFrame(fd, request))
+	{
+		string response;
+		if (request.size() == 1 && request[0] == CMD_STATS)
+			response = string(1, STATUS_OK) + getStats();
+		else if (request.size() >= 2 && request[0] == CMD_RELOAD)
+		{
+			// answered on this connection's thread, so queued and running cracks carry on meanwhile
+			if (!m_remoteReload)
+				response = string(1, STATUS_ERROR) + "reloads are only accepted on a Unix socket";
+			else if (reload(request.substr(1)))
+				response = string(1, STATUS_OK);
+			else if (m_reloading)
+				response = string(1, STATUS_BUSY);
+			else
+				response = string(1, STATUS_ERROR) + "unable to load " + request.substr(1);
+		}
+		else if (request.size() >= 5 && request[0] == CMD_CRACK)
+		{
+			shared_ptr<Job> job = make_shared<Job>();
+			job->timeLimit = getUint32(request.data() + 1);
+			if (job->timeLimit <= 0 || (m_timeLimit > 0 && job->timeLimit > m_timeLimit))
+				job->timeLimit = m_timeLimit;		// clients may ask for less time than the default, never more
+			job->ciphertext = request.substr(5);
+			job->received = chrono::steady_clock::now();
+			future<string> result = job->response.get_future();
+
+			bool accepted = false;
+			{
+				lock_guard<mutex> lock(m_mutex);
+				if (!m_stopping && m_queue.size() < m_maxQueued)
+				{
+					m_queue.push_back(job);
+					accepted = true;
+				}
+				else
+					m_numRejected++;
+			}
+			if (accepted)
+			{
+				m_queueChanged.notify_one();
+				response = result.get();				// wait for a worker to answer
+			}
+			else
+				response = string(1, STATUS_BUSY);		// backpressure: the client should retry later
+		}
+		else
+			response = string(1, STATUS_ERROR) + "malformed request";
+
+		if (!writeFrame(fd, response))
+			break;
+	}
+
+	::close(fd);
+	lock_guard<mutex> lock(m_mutex);
+	m_connections.erase(fd);
+	m_connectionsChanged.notify_all();
+}
+
+void ServerImpl::work(int worker)
+{
+	Decrypter d;
+	d.setKeyCacheSize(WORKER_KEY_CACHE_SIZE);			// traffic tends to reuse a few keys
+
+	for (;;)
+	{
+		shared_ptr<Job> job;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_queueChanged.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+			if (m_stopping)
+				return;
+			job = m_queue.front();
+			m_queue.pop_front();
+			m_numBusy++;
+		}
+
+		// the time limit counts from when the request arrived, so time spent queued is included
+		int remaining = 0;
+		if (job->timeLimit > 0)
+		{
+			remaining = job->timeLimit - chrono::duration_cast<chrono::milliseconds>(
+				chrono::steady_clock::now() - job->received).count();
+		}
+
+		string response;
+		bool timedOut;
+		if (job->timeLimit > 0 && remaining <= 0)
+		{
+			response = string(1, STATUS_TIMEOUT);
+			timedOut = true;
+		}
+		else
+		{
+			d.load(atomic_load(&m_wordList));		// just a pointer copy; picks up any reload
+			d.setTimeLimit(remaining);
+			vector<string> solutions = d.crack(job->ciphertext);
+			timedOut = d.timedOut();
+			d.unload();								// an idle worker must not keep a replaced list alive
+			response = string(1, timedOut ? STATUS_TIMEOUT : STATUS_OK);
+			for (unsigned int i = 0; i < solutions.size(); i++)
+			{
+				if (response.size() + solutions[i].size() + 1 > MAX_FRAME_SIZE)
+				{
+					response[0] = STATUS_TRUNCATED;		// the client would reject a larger frame
+					break;
+				}
+				response += solutions[i];
+				response += '\n';
+			}
+		}
+
+		double latency = chrono::duration<double, milli>(chrono::steady_clock::now() - job->received).count();
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_numBusy--;
+			if (timedOut)
+				m_numTimedOut++;
+			else
+				m_numCompleted++;
+			recordLatency(latency);
+			m_workerStats[worker] = d.getStats();
+		}
+		job->response.set_value(response);
+	}
+}
+
+string ServerImpl::getStats()
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	vector<double> sorted(m_latencies);
+	sort(sorted.begin(), sorted.end());
+	double p50 = 0;
+	double p99 = 0;
+	if (!sorted.empty())
+	{
+		p50 = sorted[(sorted.size() - 1) * 50 / 100];
+		p99 = sorted[(sorted.size() - 1) * 99 / 100];
+	}
+
+	// every worker has its own key cache, so their counters add up
+	long keyCacheHits = 0;
+	long keyCacheMisses = 0;
+	double keyCacheSavedMs = 0;
+	for (unsigned int i = 0; i < m_workerStats.size(); i++)
+	{
+		keyCacheHits += m_workerStats[i].keyCacheHits;
+		keyCacheMisses += m_workerStats[i].keyCacheMisses;
+		keyCacheSavedMs += m_workerStats[i].keyCacheSavedMs;
+	}
+
+	ostringstream out;
+	out << "queue_depth " << m_queue.size() << "\n"
+		<< "queue_capacity " << m_maxQueued << "\n"
+		<< "workers " << m_numWorkers << "\n"
+		<< "busy_workers " << m_numBusy << "\n"
+		<< "connections " << m_connections.size() << "\n"
+		<< "completed " << m_numCompleted << "\n"
+		<< "timed_out " << m_numTimedOut << "\n"
+		<< "rejected " << m_numRejected << "\n"
+		<< "refused_connections " << m_numRefused << "\n"
+		<< "reloads " << m_numReloads << "\n"
+		<< "p50_ms " << p50 << "\n"
+		<< "p99_ms " << p99 << "\n"
+		<< "key_cache_hits " << keyCacheHits << "\n"
+		<< "key_cache_misses " << keyCacheMisses << "\n"
+		<< "key_cache_saved_ms " << keyCacheSavedMs << "\n";
+	return out.str();
+}
+
+void ServerImpl::recordLatency(double milliseconds)
+{
+	if (m_latencies.size() < LATENCY_SAMPLES)
+		m_latencies.push_back(milliseconds);
+	else
+		m_latencies[m_nextLatency] = milliseconds;			// overwrite the oldest sample
+	m_nextLatency = (m_nextLatency + 1) % LATENCY_SAMPLES;
+}
+
+//******************** ClientImpl ************************************
+
+class ClientImpl
+{
+public:
+	ClientImpl();
+	~ClientImpl();
+	bool connect(string address);
+	bool crack(const string& ciphertext, vector<string>& solutions, int timeLimit);
+	bool getStats(string& stats);
+	bool reload(string filename);
+	string getStatus() const;
+private:
+	bool request(const string& payload, string& body);	// sends a request and splits off the response status
+
+	int m_fd;
+	string m_status;									// outcome of the most recent request
+};
+
+ClientImpl::ClientImpl()
+	: m_fd(-1)
+{
+}
+
+ClientImpl::~ClientImpl()
+{
+	if (m_fd >= 0)
+		::close(m_fd);
+}
+
+bool ClientImpl::connect(string address)
+{
+	if (m_fd >= 0)
+		::close(m_fd);
+	m_fd = openSocket(address, false);
+	m_status = (m_fd >= 0 ? "ok" : "error: unable to connect to " + address);
+	return m_fd >= 0;
+}
+
+bool ClientImpl::crack(const string& ciphertext, vector<string>& solutions, int timeLimit)
+{
+	string payload(1, CMD_CRACK);
+	putUint32(payload, timeLimit > 0 ? timeLimit : 0);
+	payload += ciphertext;
+
+	solutions.clear();
+	string body;
+	if (!request(payload, body))
+		return false;
+
+	// a timed out request still carries the solutions found in time
+	size_t start = 0;
+	size_t end;
+	while ((end = body.find('\n', start)) != string::npos)
+	{
+		solutions.push_back(body.substr(start, end - start));
+		start = end + 1;
+	}
+	return m_status == "ok";
+}
+
+bool ClientImpl::getStats(string& stats)
+{
+	return request(string(1, CMD_STATS), stats);
+}
+
+bool ClientImpl::reload(string filename)
+{
+	string body;
+	return request(string(1, CMD_RELOAD) + filename, body);
+}
+
+string ClientImpl::getStatus() const
+{
+	return m_status;
+}
+
+bool ClientImpl::request(const string& payload, string& body)
+{
+	string response;
+	if (m_fd < 0 || !writeFrame(m_fd, payload) || !readFrame(m_fd, response) || response.empty())
+	{
+		m_status = "error: connection to server lost";
+		return false;
+	}
+
+	body = response.substr(1);
+	switch (response[0])
+	{
+	  case STATUS_OK:
+		m_status = "ok";
+		return true;
+	  case STATUS_TIMEOUT:
+		m_status = "timeout";
+		return true;
+	  case STATUS_TRUNCATED:
+		m_status = "truncated";
+		return true;
+	  case STATUS_BUSY:
+		m_status = "busy";
+		return false;
+	  default:
+		m_status = "error: " + body;
+		return false;
+	}
+}
+
+//******************** Server functions ************************************
+
+// These functions simply delegate to ServerImpl's functions.
+
+Server::Server(int numWorkers, int maxQueued, int timeLimit)
+{
+    m_impl = new ServerImpl(numWorkers, maxQueued, timeLimit);
+}
+
+Server::~Server()
+{
+    delete m_impl;
+}
+
+bool Server::load(string filename)
+{
+    return m_impl->load(filename);
+}
+
+bool Server::reload(string filename)
+{
+    return m_impl->reload(filename);
+}
+
+bool Server::run(string address)
+{
+    return m_impl->run(address);
+}
+
+void Server::stop()
+{
+    m_impl->stop();
+}
+
+//******************** Client functions ************************************
+
+// These functions simply delegate to ClientImpl's functions.
+
+Client::Client()
+{
+    m_impl = new ClientImpl;
+}
+
+Client::~Client()
+{
+    delete m_impl;
+}
+
+bool Client::connect(string address)
+{
+    return m_impl->connect(address);
+}
+
+bool Client::crack(const string& ciphertext, vector<string>& solutions, int timeLimit)
+{
+    return m_impl->crack(ciphertext, solutions, timeLimit);
+}
+
+bool Client::getStats(string& stats)
+{
+    return m_impl->getStats(stats);
+}
+
+bool Client::reload(string filename)
+{
+    return m_impl->reload(filename);
+}
+
+string Client::getStatus() const
+{
+    return m_impl->getStatus();
+}
@@ -3,8 +3,25 @@
 #include <list>
 #include <vector>
 #include <cctype>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define TRANSLATOR_SSSE3_KERNEL		// compiled for SSSE3 regardless of the build flags, used if the CPU has it
+#endif
 using namespace std;
 
+#ifdef TRANSLATOR_SSSE3_KERNEL
+// Translates the longest prefix of in whose length is a multiple of 16 and returns that length
+static size_t translateBlocksSSSE3(const char* table, const char* in, char* out, size_t n) __attribute__((target("ssse3")));
+
+static bool cpuHasSSSE3()
+{
+	__builtin_cpu_init();		// may run before the runtime's own initialization of the CPU model
+	return __builtin_cpu_supports("ssse3");
+}
+
+static const bool CPU_HAS_SSSE3 = cpuHasSSSE3();
+#endif
+
 class TranslatorImpl
 {
 public:
@@ -12,8 +29,13 @@ public:
     bool pushMapping(string ciphertext, string plaintext);
     bool popMapping();
     string getTranslation(const string& ciphertext) const;
+    void getTranslation(const string& ciphertext, string& translation) const;
 private:
+	// Helper functions
+	void updateTable();					// rebuilds m_table from m_currMap
+
 	char m_currMap[26];					// current Translator map
+	char m_table[256];					// translation of every possible char under the current map, case included
 	list<vector<char>> m_mapStack;		// "stack" of maps that have been pushed
 	int m_numPush;						// number of times pushMapping() has been called
 	int m_numPop;						// number of times popMapping() has been called
@@ -26,6 +48,7 @@ TranslatorImpl::TranslatorImpl()
 	{
 		m_currMap[i] = '?';						// initialize current map to be all '?'
 	}
+	updateTable();
 }
 
 bool TranslatorImpl::pushMapping(string ciphertext, string plaintext)
@@ -42,12 +65,10 @@ bool TranslatorImpl::pushMapping(string ciphertext, string plaintext)
 		plaintext[i] = tolower(plaintext[i]);
 	}
 	
-	vector<char> newMap;			// will be the newest mapping
-	vector<char> oldMap;			// holds a copy of the old map
+	char newMap[26];				// will be the newest mapping; a plain array so rejected mappings cost no allocation
 	for (unsigned int i = 0; i < 26; i++)
 	{
-		newMap.push_back(m_currMap[i]);			// copy over from current 
-		oldMap.push_back(m_currMap[i]);
+		newMap[i] = m_currMap[i];				// copy over from current 
 	}
 
 	for (unsigned int j = 0; j < ciphertext.size(); j++)
@@ -73,12 +94,14 @@ bool TranslatorImpl::pushMapping(string ciphertext, string plaintext)
 		}
 	}
 
+	m_mapStack.push_front(vector<char>(m_currMap, m_currMap + 26));		// push the old map (before updates)
+
 	for (unsigned int k = 0; k < 26; k++)					// update current map with newest mappings
 	{
 		m_currMap[k] = newMap[k];
 	}
+	updateTable();
 
-	m_mapStack.push_front(oldMap);							// push the old map (before updates)
 	m_numPush++;											// increase the number of pushes
 
 	return true;
@@ -96,6 +119,7 @@ bool TranslatorImpl::popMapping()
 
 		m_mapStack.pop_front();								// pop off the map
 		m_numPop++;	
+		updateTable();
 		return true;
 	}
 }
@@ -103,19 +127,84 @@ bool TranslatorImpl::popMapping()
 string TranslatorImpl::getTranslation(const string& ciphertext) const
 {
 	string translation;										// string to hold translation
-	for (unsigned int i = 0; i < ciphertext.size(); i++)
+	getTranslation(ciphertext, translation);
+	return translation;
+}
+
+void TranslatorImpl::getTranslation(const string& ciphertext, string& translation) const
+{
+	// the translation is the same length as the ciphertext, so this only allocates when
+	// the caller's buffer is too small
+	translation.resize(ciphertext.size());
+	const char* in = ciphertext.data();
+	char* out = &translation[0];
+	size_t n = ciphertext.size();
+	size_t i = 0;
+
+#ifdef TRANSLATOR_SSSE3_KERNEL
+	if (n >= 16 && CPU_HAS_SSSE3)
+		i = translateBlocksSSSE3(m_table, in, out, n);
+#endif
+
+	for (; i < n; i++)
+		out[i] = m_table[static_cast<unsigned char>(in[i])];
+}
+
+//////////////////////////////////////////
+// Helper functions
+//////////////////////////////////////////
+
+#ifdef TRANSLATOR_SSSE3_KERNEL
+static size_t translateBlocksSSSE3(const char* table, const char* in, char* out, size_t n)
+{
+	// translate 16 characters at a time: each letter is looked up with a pair of byte shuffles
+	// over the table entries for a-p and q-z (A-P and Q-Z for capitals), everything else passes through
+	const __m128i lowerFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 'a'));
+	const __m128i lowerSecond = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 'q'));
+	const __m128i upperFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 'A'));
+	const __m128i upperSecond = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 'Q'));
+	const __m128i fifteen = _mm_set1_epi8(15);
+	const __m128i sixteen = _mm_set1_epi8(16);
+
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
 	{
-		char curr = tolower(ciphertext[i]);					// change each character to lowercase in a temp variable for processing
-		if (!isalpha(curr))									// if not alphabetic, add the character and go to the next iteration
-		{
-			translation += curr;
-			continue;
-		}
-		translation += m_currMap[curr - 'a'];				// concatenate the new character to the translation
-		if (isupper(ciphertext[i]))							// if the current character in ciphertext is uppercase, change the translation char to reflect this
-			translation[translation.size() - 1] = toupper(translation[translation.size() - 1]);
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+
+		__m128i isLower = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('z' + 1)));
+		__m128i isUpper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+
+		__m128i lowerIndex = _mm_sub_epi8(v, _mm_set1_epi8('a'));
+		__m128i lowerInSecond = _mm_cmpgt_epi8(lowerIndex, fifteen);
+		__m128i lower = _mm_or_si128(
+			_mm_andnot_si128(lowerInSecond, _mm_shuffle_epi8(lowerFirst, lowerIndex)),
+			_mm_and_si128(lowerInSecond, _mm_shuffle_epi8(lowerSecond, _mm_sub_epi8(lowerIndex, sixteen))));
+
+		__m128i upperIndex = _mm_sub_epi8(v, _mm_set1_epi8('A'));
+		__m128i upperInSecond = _mm_cmpgt_epi8(upperIndex, fifteen);
+		__m128i upper = _mm_or_si128(
+			_mm_andnot_si128(upperInSecond, _mm_shuffle_epi8(upperFirst, upperIndex)),
+			_mm_and_si128(upperInSecond, _mm_shuffle_epi8(upperSecond, _mm_sub_epi8(upperIndex, sixteen))));
+
+		__m128i result = _mm_or_si128(
+			_mm_or_si128(_mm_and_si128(isLower, lower), _mm_and_si128(isUpper, upper)),
+			_mm_andnot_si128(_mm_or_si128(isLower, isUpper), v));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), result);
+	}
+	return i;
+}
+#endif
+
+void TranslatorImpl::updateTable()
+{
+	for (int c = 0; c < 256; c++)
+		m_table[c] = c;										// non-letters translate to themselves
+
+	for (int i = 0; i < 26; i++)
+	{
+		m_table['a' + i] = m_currMap[i];
+		m_table['A' + i] = toupper(m_currMap[i]);			// capitals keep their case; '?' stays '?'
 	}
-	return translation;
 }
 
 //******************** Translator functions ************************************
@@ -147,3 +236,8 @@ string Translator::getTranslation(const string& ciphertext) const
 {
     return m_impl->getTranslation(ciphertext);
 }
+
+void Translator::getTranslation(const string& ciphertext, string& translation) const
+{
+    m_impl->getTranslation(ciphertext, translation);
+}
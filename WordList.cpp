@@ -5,6 +5,7 @@
 #include <functional>
 #include <fstream>
 #include <cctype>
+#include <sstream>
 using namespace std;
 
 class WordListImpl
@@ -12,25 +13,99 @@ class WordListImpl
 public:
 	WordListImpl();
     bool loadWordList(string filename);
+    bool loadWordList(string filename, const vector<string>& neededWords);
+    bool covers(const vector<string>& words) const;
+    string getFilename() const;
     bool contains(string word) const;
+    bool containsBigram(char first, char second) const;
     vector<string> findCandidates(string cipherWord, string currTranslation) const;
+    void findCandidates(const string& cipherWord, const string& currTranslation, vector<const string*>& candidates) const;
+    int countPatternMatches(string word) const;
+    string getStats() const;
 private:
 	MyHash<string, vector<string>> m_hash1;			// m_hash1 holds the patterns and its corresponding words with such pattern
 	MyHash<string, char>	m_hash2;				// m_hash2 holds the words in the word list as keys, with dummy values for value
+	bool m_bigrams[26][26];							// m_bigrams[a][b] is true if letter b directly follows letter a in some word
+
+	// Partial loading: only the word lengths and patterns some message needs are indexed
+	string m_filename;								// file the list was loaded from
+	bool m_partial;									// whether only some of the words were indexed
+	vector<bool> m_neededLengths;					// m_neededLengths[n] is true if words of length n were indexed
+	MyHash<string, char> m_neededPatterns;			// patterns whose words were indexed, with dummy values
 
 	// Helper functions
 	string getPattern(string word) const;			// gets the pattern of a string
+	bool readWordList(string filename);				// indexes the words of the file, subject to the partial loading filter
+	bool isIndexed(const string& word) const;		// whether word's length and pattern are covered by the index
 };
 
 WordListImpl::WordListImpl()
+	: m_partial(false)
 {
+	for (int i = 0; i < 26; i++)
+		for (int j = 0; j < 26; j++)
+			m_bigrams[i][j] = false;
 }
 
 bool WordListImpl::loadWordList(string filename)
 {
+	m_partial = false;
+	return readWordList(filename);
+}
+
+bool WordListImpl::loadWordList(string filename, const vector<string>& neededWords)
+{
+	// remember which lengths and patterns the words need; no list word has characters other than
+	// letters and apostrophes, so words containing them need nothing indexed
+	m_partial = true;
+	m_neededLengths.clear();
+	m_neededPatterns.reset();
+	for (unsigned int i = 0; i < neededWords.size(); i++)
+	{
+		string word = neededWords[i];
+		bool validWord = true;
+		for (unsigned int j = 0; j < word.size(); j++)
+		{
+			word[j] = tolower(word[j]);
+			if (!isalpha(word[j]) && word[j] != '\'')
+				validWord = false;
+		}
+		if (!validWord)
+			continue;
+
+		if (word.size() >= m_neededLengths.size())
+			m_neededLengths.resize(word.size() + 1, false);
+		m_neededLengths[word.size()] = true;
+		m_neededPatterns.associate(getPattern(word), ' ');
+	}
+	return readWordList(filename);
+}
+
+bool WordListImpl::covers(const vector<string>& words) const
+{
+	for (unsigned int i = 0; i < words.size() && m_partial; i++)
+	{
+		if (!isIndexed(words[i]))
+			return false;
+	}
+	return true;
+}
+
+string WordListImpl::getFilename() const
+{
+	return m_filename;
+}
+
+bool WordListImpl::readWordList(string filename)
+{
+	m_filename = filename;
+
 	// clear the current hash tables
 	m_hash1.reset();
 	m_hash2.reset();
+	for (int i = 0; i < 26; i++)
+		for (int j = 0; j < 26; j++)
+			m_bigrams[i][j] = false;
 
 	ifstream infile(filename);	// read file input
 	if (!infile)
@@ -53,9 +128,21 @@ bool WordListImpl::loadWordList(string filename)
 		if (ignoreWord)
 			continue;
 
+		for (unsigned int i = 1; i < s.size(); i++)		// record every pair of adjacent letters that occurs in the word
+		{
+			if (isalpha(s[i - 1]) && isalpha(s[i]))
+				m_bigrams[s[i - 1] - 'a'][s[i] - 'a'] = true;
+		}
+
+		// when partially loading, skip words of a length no needed word has
+		if (m_partial && (s.size() >= m_neededLengths.size() || !m_neededLengths[s.size()]))
+			continue;
+
 		m_hash2.associate(s, ' ');		// inserts word into 2nd hashmap
 
 		string pattern = getPattern(s);
+		if (m_partial && m_neededPatterns.find(pattern) == nullptr)
+			continue;					// no needed word has this pattern
 		
 		vector<string>* v = m_hash1.find(pattern);
 		if (v == nullptr)			// if pattern not already in the map
@@ -81,31 +168,49 @@ bool WordListImpl::contains(string word) const
 	return false;
 }
 
+bool WordListImpl::containsBigram(char first, char second) const
+{
+	first = tolower(first);
+	second = tolower(second);
+	if (!isalpha(first) || !isalpha(second))
+		return false;
+	return m_bigrams[first - 'a'][second - 'a'];
+}
+
 vector<string> WordListImpl::findCandidates(string cipherWord, string currTranslation) const
 {
+	vector<const string*> matches;
+	findCandidates(cipherWord, currTranslation, matches);
+
+	vector<string> candidates;			// copies of the matching words
+	for (unsigned int i = 0; i < matches.size(); i++)
+		candidates.push_back(*matches[i]);
+	return candidates;
+}
+
+void WordListImpl::findCandidates(const string& cipherWord, const string& currTranslation, vector<const string*>& candidates) const
+{
+	candidates.clear();					// the caller's buffer keeps its capacity, so filling it rarely allocates
 	if (cipherWord.size() != currTranslation.size())
-		return vector<string>();
+		return;
 
-	for (unsigned int i = 0; i < cipherWord.size(); i++)
+	string lowerCipherWord = cipherWord;
+	for (unsigned int i = 0; i < lowerCipherWord.size(); i++)
 	{
-		cipherWord[i] = tolower(cipherWord[i]);		// turns all characters to lowercase
+		lowerCipherWord[i] = tolower(lowerCipherWord[i]);		// turns all characters to lowercase
 		// check that cipherword and currTranslation only contain alphabetic or apostrophes, or '?' (currTranslation only)
-		if ((!isalpha(cipherWord[i]) && cipherWord[i] != '\'') && (!isalpha(currTranslation[i]) && currTranslation[i] != '\'' && currTranslation[i] != '?'))
-			return vector<string>();
-
+		if ((!isalpha(lowerCipherWord[i]) && lowerCipherWord[i] != '\'') && (!isalpha(currTranslation[i]) && currTranslation[i] != '\'' && currTranslation[i] != '?'))
+			return;
 	}
 
-	string cipherPattern = getPattern(cipherWord);		// get the pattern for the given cipherWord
-
-	const vector<string>* potentialMatches = m_hash1.find(cipherPattern);	// holds the vector of strings that match the cipherWord pattern
-	vector<string> candidates;												// holds the vector of candidates that match the current translation
+	const vector<string>* potentialMatches = m_hash1.find(getPattern(lowerCipherWord));	// holds the vector of strings that match the cipherWord pattern
 
-	if (potentialMatches == nullptr)		// if no potential matches found, return an empty vector
-		return vector<string>();
+	if (potentialMatches == nullptr)		// if no potential matches found, leave the buffer empty
+		return;
 
 	for (unsigned int i = 0; i < potentialMatches->size(); i++)
 	{
-		string curr = (*potentialMatches)[i];	// curr holds the current string we are evaluating
+		const string& curr = (*potentialMatches)[i];	// curr refers to the current string we are evaluating, without copying it
 		bool isCandidate = true;				// bool to tell us whether or not a string is a candidate
 		for (unsigned int j = 0; j < currTranslation.size(); j++)
 		{
@@ -122,11 +227,60 @@ vector<string> WordListImpl::findCandidates(string cipherWord, string currTransl
 		}
 		if (isCandidate)
 		{
-			candidates.push_back(curr);		// if the word is a candidate, push it onto the vector
+			candidates.push_back(&curr);		// if the word is a candidate, point at it in the word list
 		}
 	}
+}
 
-	return candidates;
+int WordListImpl::countPatternMatches(string word) const
+{
+	for (unsigned int i = 0; i < word.size(); i++)
+	{
+		word[i] = tolower(word[i]);
+		if (!isalpha(word[i]) && word[i] != '\'')
+			return 0;
+	}
+
+	const vector<string>* matches = m_hash1.find(getPattern(word));	// every word with the same pattern
+	if (matches == nullptr)
+		return 0;
+	return matches->size();
+}
+
+// Appends a report of one of the hash tables to out
+static void printHashStats(ostringstream& out, const string& name, const HashStats& stats)
+{
+	out << name << ":\n"
+		<< "  items           " << stats.numItems << "\n"
+		<< "  buckets         " << stats.numBuckets << " (" << stats.emptyBuckets * 100.0 / stats.numBuckets << "% empty)\n"
+		<< "  load factor     " << stats.loadFactor << " (max " << stats.maxLoadFactor << ")\n"
+		<< "  longest chain   " << stats.longestChain << "\n"
+		<< "  chain lengths  ";
+	for (unsigned int i = 0; i < stats.chainLengths.size(); i++)
+		out << " " << i << ":" << stats.chainLengths[i];
+	out << "\n"
+		<< "  rehashes        " << stats.numRehashes << " (" << stats.rehashSeconds * 1000 << " ms)\n"
+		<< "  heap bytes      " << stats.bytesUsed << "\n";
+}
+
+string WordListImpl::getStats() const
+{
+	HashStats patterns = m_hash1.getStats();
+	HashStats words = m_hash2.getStats();
+
+	int numBigrams = 0;
+	for (int i = 0; i < 26; i++)
+		for (int j = 0; j < 26; j++)
+			if (m_bigrams[i][j])
+				numBigrams++;
+
+	ostringstream out;
+	printHashStats(out, "pattern index", patterns);
+	printHashStats(out, "word index", words);
+	out << "index             " << (m_partial ? "partial (only the lengths and patterns one message needs)" : "full") << "\n"
+		<< "letter pairs seen " << numBigrams << " of 676\n"
+		<< "total heap bytes  " << patterns.bytesUsed + words.bytesUsed + sizeof(*this) << "\n";
+	return out.str();
 }
 
 string WordListImpl::getPattern(string word) const
@@ -154,6 +308,23 @@ string WordListImpl::getPattern(string word) const
 	return temp;		// return the new pattern string
 }
 
+bool WordListImpl::isIndexed(const string& word) const
+{
+	if (!m_partial)
+		return true;
+
+	string lower = word;
+	for (unsigned int i = 0; i < lower.size(); i++)
+	{
+		lower[i] = tolower(lower[i]);
+		if (!isalpha(lower[i]) && lower[i] != '\'')
+			return true;		// no list word can equal or match this word, so the full list would not help
+	}
+	if (lower.size() >= m_neededLengths.size() || !m_neededLengths[lower.size()])
+		return false;
+	return m_neededPatterns.find(getPattern(lower)) != nullptr;
+}
+
 //***** hash functions for string, int, and char *****
 
 unsigned int hasher(const std::string& s)
@@ -171,6 +342,34 @@ unsigned int hasher(const char& c)
     return std::hash<char>()(c);
 }
 
+//***** heap size estimates for string, vector of strings, int, and char *****
+
+size_t heapSize(const std::string& s)
+{
+    const char* object = reinterpret_cast<const char*>(&s);
+    if (s.data() >= object && s.data() < object + sizeof(s))
+        return 0;                       // short strings are stored inside the string object itself
+    return s.capacity() + 1;
+}
+
+size_t heapSize(const std::vector<std::string>& v)
+{
+    size_t bytes = v.capacity() * sizeof(std::string);
+    for (size_t i = 0; i < v.size(); i++)
+        bytes += heapSize(v[i]);
+    return bytes;
+}
+
+size_t heapSize(const int&)
+{
+    return 0;
+}
+
+size_t heapSize(const char&)
+{
+    return 0;
+}
+
 //******************** WordList functions ************************************
 
 // These functions simply delegate to WordListImpl's functions.
@@ -191,12 +390,47 @@ bool WordList::loadWordList(string filename)
     return m_impl->loadWordList(filename);
 }
 
+bool WordList::loadWordList(string filename, const vector<string>& neededWords)
+{
+    return m_impl->loadWordList(filename, neededWords);
+}
+
+bool WordList::covers(const vector<string>& words) const
+{
+    return m_impl->covers(words);
+}
+
+string WordList::getFilename() const
+{
+    return m_impl->getFilename();
+}
+
 bool WordList::contains(string word) const
 {
     return m_impl->contains(word);
 }
 
+bool WordList::containsBigram(char first, char second) const
+{
+    return m_impl->containsBigram(first, second);
+}
+
 vector<string> WordList::findCandidates(string cipherWord, string currTranslation) const
 {
    return m_impl->findCandidates(cipherWord, currTranslation);
 }
+
+void WordList::findCandidates(const string& cipherWord, const string& currTranslation, vector<const string*>& candidates) const
+{
+   m_impl->findCandidates(cipherWord, currTranslation, candidates);
+}
+
+int WordList::countPatternMatches(string word) const
+{
+    return m_impl->countPatternMatches(word);
+}
+
+string WordList::getStats() const
+{
+    return m_impl->getStats();
+}
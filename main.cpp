@@ -43,7 +43,7 @@ string encrypt(string plaintext)
 bool decrypt(string ciphertext)
 {
 	Decrypter d;
-	if ( ! d.load(WORDLIST_FILE))
+	if ( ! d.load(WORDLIST_FILE, ciphertext))
 	{
 		cout << "Unable to load word list file " << WORDLIST_FILE << endl;
 		return false;
@@ -53,9 +53,126 @@ bool decrypt(string ciphertext)
 	return true;
 }
 
+bool decryptResumably(string checkpointFile, string ciphertext)
+{
+	Decrypter d;
+	if ( ! d.load(WORDLIST_FILE, ciphertext))
+	{
+		cout << "Unable to load word list file " << WORDLIST_FILE << endl;
+		return false;
+	}
+	vector<string> solutions;
+	if ( ! d.crack(ciphertext, checkpointFile, solutions))
+	{
+		if (d.resumeFailure() == ResumeFailure::WordListUnreadable)
+			cout << "Unable to load word list file " << WORDLIST_FILE << endl;
+		else if (d.resumeFailure() == ResumeFailure::WordListChanged)
+			cout << "Checkpoint file " << checkpointFile << " was written with a different word list" << endl;
+		else
+			cout << "Checkpoint file " << checkpointFile << " belongs to another crack or is damaged" << endl;
+		return false;
+	}
+	for (const auto& s : solutions)
+		cout << s << endl;
+	return true;
+}
+
+bool decryptJointly(const vector<string>& ciphertexts)
+{
+	string allText;
+	for (const auto& c : ciphertexts)
+		allText += c + " ";
+	Decrypter d;
+	if ( ! d.load(WORDLIST_FILE, allText))
+	{
+		cout << "Unable to load word list file " << WORDLIST_FILE << endl;
+		return false;
+	}
+	  // One block of lines per key, separated by blank lines
+	vector<vector<string>> keySolutions = d.crack(ciphertexts);
+	for (size_t k = 0; k < keySolutions.size(); k++)
+	{
+		if (k > 0)
+			cout << endl;
+		for (const auto& s : keySolutions[k])
+			cout << s << endl;
+	}
+	return true;
+}
+
+bool printWordListStats(string filename)
+{
+	WordList wl;
+	if ( ! wl.loadWordList(filename))
+	{
+		cout << "Unable to load word list file " << filename << endl;
+		return false;
+	}
+	cout << wl.getStats();
+	return true;
+}
+
+bool serve(string address)
+{
+	Server server;
+	if ( ! server.load(WORDLIST_FILE))
+	{
+		cout << "Unable to load word list file " << WORDLIST_FILE << endl;
+		return false;
+	}
+	if ( ! server.run(address))
+	{
+		cout << "Unable to listen on " << address << endl;
+		return false;
+	}
+	return true;
+}
+
+bool requestDecrypt(string address, string ciphertext)
+{
+	Client c;
+	vector<string> solutions;
+	bool ok = c.connect(address)  &&  c.crack(ciphertext, solutions);
+	for (const auto& s : solutions)
+		cout << s << endl;
+	if (c.getStatus() != "ok")
+		cerr << c.getStatus() << endl;
+	return ok;
+}
+
+bool requestStats(string address)
+{
+	Client c;
+	string stats;
+	if ( ! c.connect(address)  ||  ! c.getStats(stats))
+	{
+		cerr << c.getStatus() << endl;
+		return false;
+	}
+	cout << stats;
+	return true;
+}
+
+bool requestReload(string address, string filename)
+{
+	Client c;
+	if ( ! c.connect(address)  ||  ! c.reload(filename))
+	{
+		cerr << c.getStatus() << endl;
+		return false;
+	}
+	return true;
+}
+
 int main(int argc, char* argv[])
 {
-	if (argc == 3  &&  argv[1][0] == '-')
+	if (argc >= 3  &&  argv[1][0] == '-'  &&  tolower(argv[1][1]) == 'j')
+	{
+		if (decryptJointly(vector<string>(argv + 2, argv + argc)))
+			return 0;
+		return 1;
+	}
+	else if (argc == 3  &&  argv[1][0] == '-')
 	{
 		switch (tolower(argv[1][1]))
 		{
@@ -66,11 +183,48 @@ int main(int argc, char* argv[])
 			if (decrypt(argv[2]))
 				return 0;
 			return 1;
+		  case 's':
+			if (serve(argv[2]))
+				return 0;
+			return 1;
+		  case 'q':
+			if (requestStats(argv[2]))
+				return 0;
+			return 1;
+		  case 'i':
+			if (printWordListStats(argv[2]))
+				return 0;
+			return 1;
+		}
+	}
+	else if (argc == 4  &&  argv[1][0] == '-')
+	{
+		switch (tolower(argv[1][1]))
+		{
+		  case 'c':
+			if (requestDecrypt(argv[2], argv[3]))
+				return 0;
+			return 1;
+		  case 'r':
+			if (requestReload(argv[2], argv[3]))
+				return 0;
+			return 1;
+		  case 'k':
+			if (decryptResumably(argv[2], argv[3]))
+				return 0;
+			return 1;
 		}
 	}
 
 	cout << "Usage to encrypt:  " << argv[0] << " -e \"Your message here.\"" << endl;
 	cout << "Usage to decrypt:  " << argv[0] << " -d \"Uwey tirrboi miyi.\"" << endl;
+	cout << "Usage to resume:   " << argv[0] << " -k checkpoint.txt \"Uwey tirrboi miyi.\"" << endl;
+	cout << "Usage for one key: " << argv[0] << " -j \"Uwey tirrboi miyi.\" \"Uir, reyi.\" ..." << endl;
+	cout << "Usage to serve:    " << argv[0] << " -s /path/to/socket  (or a localhost port number)" << endl;
+	cout << "Usage as client:   " << argv[0] << " -c /path/to/socket \"Uwey tirrboi miyi.\"" << endl;
+	cout << "Usage for stats:   " << argv[0] << " -q /path/to/socket" << endl;
+	cout << "Usage to reload:   " << argv[0] << " -r /path/to/socket new_wordlist.txt" << endl;
+	cout << "Usage for indexes: " << argv[0] << " -i " << WORDLIST_FILE << endl;
 	return 1;
 }
 
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 
 class TokenizerImpl;
 
@@ -27,8 +28,19 @@ public:
     WordList();
     ~WordList();
     bool loadWordList(std::string filename);
+      // Indexes only the word lengths and patterns that neededWords can use.  Lookups outside them
+      // answer as if the list had no such words, so check covers() before relying on them.
+    bool loadWordList(std::string filename, const std::vector<std::string>& neededWords);
+      // Whether every one of words can be looked up; always true for a fully loaded list
+    bool covers(const std::vector<std::string>& words) const;
+    std::string getFilename() const;
     bool contains(std::string word) const;
+    bool containsBigram(char first, char second) const;
     std::vector<std::string> findCandidates(std::string cipherWord, std::string currTranslation) const;
+      // Fills candidates with pointers to the matching words in the list's own storage, valid until it is reloaded
+    void findCandidates(const std::string& cipherWord, const std::string& currTranslation, std::vector<const std::string*>& candidates) const;
+    int countPatternMatches(std::string word) const;
+    std::string getStats() const;
       // We prevent a WordList object from being copied or assigned.
     WordList(const WordList&) = delete;
     WordList& operator=(const WordList&) = delete;
@@ -46,6 +58,7 @@ public:
     bool pushMapping(std::string ciphertext, std::string plaintext);
     bool popMapping();
     std::string getTranslation(const std::string& ciphertext) const;
+    void getTranslation(const std::string& ciphertext, std::string& translation) const;
       // We prevent an Translator object from being copied or assigned.
     Translator(const Translator&) = delete;
     Translator& operator=(const Translator&) = delete;
@@ -53,6 +66,25 @@ private:
     TranslatorImpl* m_impl;
 };
 
+struct DecrypterStats
+{
+    long candidateCacheHits;        // candidate lists served straight from the cache
+    long candidateCacheFiltered;    // candidate lists derived by filtering a cached broader list
+    long candidateCacheMisses;      // candidate lists that needed a scan of the word list
+    long keyCacheHits;              // messages answered by a recently recovered key without searching
+    long keyCacheMisses;            // messages no cached key fit, so they were searched
+    double keyCacheSavedMs;         // estimated time the key cache saved, in milliseconds
+};
+
+  // Why a resumable crack returned false, other than running out of time
+enum class ResumeFailure
+{
+    None,                   // the last resumable crack did not fail
+    CheckpointUnusable,     // the checkpoint belongs to another crack, or its solutions file is damaged
+    WordListUnreadable,     // the word list the message needs could not be read
+    WordListChanged         // the word list gives different candidates than when the checkpoint was written
+};
+
 class DecrypterImpl;
 
 class Decrypter
@@ -61,7 +93,32 @@ public:
     Decrypter();
     ~Decrypter();
     bool load(std::string filename);
+      // Loads only what ciphertext needs; cracking another message loads the rest of the file then, and
+      // finds no solutions if it can no longer be read
+    bool load(std::string filename, const std::string& ciphertext);
+    bool load(std::shared_ptr<const WordList> wordList);
+      // Safe to call while another thread is inside crack(): that crack finishes with the list it started with
+    bool reload(std::string filename);
+      // Lets go of the word list, so that it can be freed while the Decrypter is idle; load one before cracking
+    void unload();
+      // With the key cache on, a message that a cached key fits is not searched: the result is that key's
+      // translation alone, even if a search would have found more solutions
     std::vector<std::string> crack(const std::string& ciphertext);
+      // Cracks messages known to share one key; each element holds every message's plaintext under one key
+    std::vector<std::vector<std::string>> crack(const std::vector<std::string>& ciphertexts);
+      // Resumable crack: continues from checkpointFile if it holds an unfinished crack of this message and keeps
+      // it up to date, keeping the solutions found so far in checkpointFile + ".solutions"; returns true once the
+      // search is complete, false if it hit the time limit or resumeFailure() says why it could not go on
+    bool crack(const std::string& ciphertext, const std::string& checkpointFile, std::vector<std::string>& solutions);
+    ResumeFailure resumeFailure() const;
+    void setFrequencyPriors(bool enabled);
+    void setLongTextMode(bool enabled);
+    void setTimeLimit(int milliseconds);
+      // Keys of the last numKeys messages with exactly one solution are tried before searching;
+      // 0, the default, turns this off
+    void setKeyCacheSize(int numKeys);
+    bool timedOut() const;
+    DecrypterStats getStats() const;
       // We prevent a Decrypter object from being copied or assigned.
     Decrypter(const Decrypter&) = delete;
     Decrypter& operator=(const Decrypter&) = delete;
@@ -69,4 +126,46 @@ private:
     DecrypterImpl* m_impl;
 };
 
+class ServerImpl;
+
+class Server
+{
+public:
+      // numWorkers <= 0 uses one worker per hardware thread; timeLimit is in milliseconds, 0 for none
+    Server(int numWorkers = 0, int maxQueued = 64, int timeLimit = 10000);
+    ~Server();
+    bool load(std::string filename);
+      // May be called from another thread while run() is serving; fails if another reload is under way
+    bool reload(std::string filename);
+    bool run(std::string address);
+    void stop();
+      // We prevent a Server object from being copied or assigned.
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+private:
+    ServerImpl* m_impl;
+};
+
+class ClientImpl;
+
+class Client
+{
+public:
+    Client();
+    ~Client();
+    bool connect(std::string address);
+    bool crack(const std::string& ciphertext, std::vector<std::string>& solutions, int timeLimit = 0);
+    bool getStats(std::string& stats);
+      // Asks the server to switch to another word list file, named as the server sees it; only servers
+      // listening on a Unix socket accept this
+    bool reload(std::string filename);
+      // "ok", "timeout", "truncated" (more solutions than fit in one response), "busy" or "error: ..."
+    std::string getStatus() const;
+      // We prevent a Client object from being copied or assigned.
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+private:
+    ClientImpl* m_impl;
+};
+
 #endif // PROVIDED_INCLUDED